@@ -0,0 +1,179 @@
+/*
+ * File: cache.c
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	This file contains an implementation of a simple
+ *      chained hash table of lookup results, bounded in size
+ *      by CLOCK eviction.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "cache.h"
+
+static unsigned long cache_hash(int type, const char* key){
+
+    /* djb2 */
+    unsigned long h = 5381 + type;
+
+    while(*key){
+	h = ((h << 5) + h) + (unsigned char) *key++;
+    }
+
+    return h;
+}
+
+int cache_init(cache* c, int size, int maxentries){
+
+    int i;
+
+    /* user specified size or default */
+    if(size>0) {
+	c->nbuckets = size;
+    }
+    else {
+	c->nbuckets = CACHEDEFAULTSIZE;
+    }
+
+    /* malloc buckets */
+    c->buckets = malloc(sizeof(cache_entry*) * (c->nbuckets));
+    if(!(c->buckets)){
+	perror("Error on cache Malloc");
+	return CACHE_FAILURE;
+    }
+
+    /* Set to NULL */
+    for(i=0; i < c->nbuckets; ++i){
+	c->buckets[i] = NULL;
+    }
+
+    /* malloc clock ring */
+    c->maxentries = maxentries > 0 ? maxentries : c->nbuckets;
+    c->nentries = 0;
+    c->hand = 0;
+    c->ring = malloc(sizeof(cache_entry*) * (c->maxentries));
+    if(!(c->ring)){
+	perror("Error on cache Malloc");
+	free(c->buckets);
+	return CACHE_FAILURE;
+    }
+
+    return c->nbuckets;
+}
+
+int cache_lookup(cache* c, int type, const char* key,
+		 char* value, int maxSize, int* status){
+
+    cache_entry* e;
+
+    e = c->buckets[cache_hash(type, key) % c->nbuckets];
+    for(; e != NULL; e = e->next){
+	if(e->type == type && !strcmp(e->key, key)){
+	    strncpy(value, e->value, maxSize);
+	    value[maxSize-1] = '\0';
+	    *status = e->status;
+	    e->referenced = 1;
+	    return CACHE_SUCCESS;
+	}
+    }
+
+    return CACHE_FAILURE;
+}
+
+/* Advance the hand past referenced entries, clearing them,
+ * and take the first unreferenced one out of its bucket
+ * Returns the ring slot it held
+ */
+static int cache_evict(cache* c){
+
+    cache_entry* victim;
+    cache_entry** p;
+    int slot;
+
+    while(c->ring[c->hand]->referenced){
+	c->ring[c->hand]->referenced = 0;
+	c->hand = (c->hand + 1) % c->nentries;
+    }
+    slot = c->hand;
+    c->hand = (c->hand + 1) % c->nentries;
+    victim = c->ring[slot];
+
+    p = &c->buckets[cache_hash(victim->type, victim->key) % c->nbuckets];
+    while(*p != victim){
+	p = &(*p)->next;
+    }
+    *p = victim->next;
+
+    free(victim->key);
+    free(victim->value);
+    free(victim);
+
+    return slot;
+}
+
+int cache_insert(cache* c, int type, const char* key,
+		 const char* value, int status){
+
+    cache_entry* e;
+    unsigned long b = cache_hash(type, key) % c->nbuckets;
+    int slot;
+
+    /* Keep the first answer if two threads raced on a name */
+    for(e = c->buckets[b]; e != NULL; e = e->next){
+	if(e->type == type && !strcmp(e->key, key)){
+	    return CACHE_SUCCESS;
+	}
+    }
+
+    e = malloc(sizeof(*e));
+    if(!e){
+	perror("Error on cache Malloc");
+	return CACHE_FAILURE;
+    }
+    e->type = type;
+    e->status = status;
+    e->referenced = 0;
+    e->key = strdup(key);
+    e->value = strdup(value);
+    if(!(e->key) || !(e->value)){
+	free(e->key);
+	free(e->value);
+	free(e);
+	return CACHE_FAILURE;
+    }
+
+    /* Full: the new entry takes the evicted one's place on the ring */
+    if(c->nentries == c->maxentries){
+	slot = cache_evict(c);
+    }
+    else{
+	slot = c->nentries++;
+    }
+    c->ring[slot] = e;
+
+    e->next = c->buckets[b];
+    c->buckets[b] = e;
+
+    return CACHE_SUCCESS;
+}
+
+void cache_cleanup(cache* c)
+{
+    int i;
+    cache_entry* e;
+    cache_entry* next;
+
+    for(i=0; i < c->nbuckets; ++i){
+	for(e = c->buckets[i]; e != NULL; e = next){
+	    next = e->next;
+	    free(e->key);
+	    free(e->value);
+	    free(e);
+	}
+    }
+
+    free(c->buckets);
+    free(c->ring);
+}
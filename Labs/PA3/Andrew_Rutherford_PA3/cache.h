@@ -0,0 +1,74 @@
+/*
+ * File: cache.h
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	This is the header file for a simple chained hash table
+ *      that remembers lookup results so repeated names are only
+ *      resolved once. It holds at most a fixed number of entries;
+ *      once full, each insert evicts one chosen by the CLOCK
+ *      algorithm, so memory does not grow with the input.
+ *      Not thread safe; callers provide locking.
+ *
+ */
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdio.h>
+
+#define CACHEDEFAULTSIZE 1024
+
+#define CACHE_FAILURE -1
+#define CACHE_SUCCESS 0
+
+/* Kinds of lookups kept in the cache */
+#define CACHE_FORWARD 0
+#define CACHE_REVERSE 1
+
+typedef struct cache_entry_s{
+    int type;
+    int status;
+    int referenced; //looked up since the clock hand last passed
+    char* key;
+    char* value;
+    struct cache_entry_s* next;
+} cache_entry;
+
+typedef struct cache_s{
+    cache_entry** buckets;
+    int nbuckets;
+    cache_entry** ring; //every entry, in the order the hand visits them
+    int maxentries;
+    int nentries;
+    int hand;
+} cache;
+
+/* Function to initilize a new cache of size buckets holding
+ * at most maxentries results (size of them if maxentries <= 0)
+ * On success, returns number of buckets
+ * On failure, returns CACHE_FAILURE
+ * Must be called before cache is used
+ */
+int cache_init(cache* c, int size, int maxentries);
+
+/* Function to find a previous result for key
+ * On hit, copies the value to value of size maxSize,
+ * stores the saved lookup status in status and
+ * returns CACHE_SUCCESS.
+ * Returns CACHE_FAILURE on a miss.
+ */
+int cache_lookup(cache* c, int type, const char* key,
+		 char* value, int maxSize, int* status);
+
+/* Function to remember the result of a lookup, evicting
+ * another if the cache is full
+ * Returns CACHE_SUCCESS if the insert succeeds.
+ * Returns CACHE_FAILURE if the insert fails
+ */
+int cache_insert(cache* c, int type, const char* key,
+		 const char* value, int status);
+
+/* Function to free cache memory */
+void cache_cleanup(cache* c);
+
+#endif
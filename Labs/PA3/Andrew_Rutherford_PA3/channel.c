@@ -0,0 +1,78 @@
+/*
+ * File: channel.c
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	This file contains an implementation of a bounded,
+ *      blocking channel between pipeline stages.
+ *
+ */
+
+#include "channel.h"
+
+int channel_init(channel* ch, int size, int writers){
+
+    if(queue_init(&(ch->q), size) == QUEUE_FAILURE){
+	return CHANNEL_FAILURE;
+    }
+
+    ch->writers = writers;
+    pthread_mutex_init(&(ch->lock), NULL);
+    pthread_cond_init(&(ch->not_full), NULL);
+    pthread_cond_init(&(ch->not_empty), NULL);
+
+    return ch->q.maxSize;
+}
+
+int channel_push(channel* ch, void* payload){
+
+    /* NULL marks an empty slot in the queue */
+    if(!payload){
+	return CHANNEL_FAILURE;
+    }
+
+    pthread_mutex_lock(&(ch->lock));
+    while(queue_is_full(&(ch->q))){
+	pthread_cond_wait(&(ch->not_full), &(ch->lock));
+    }
+    queue_push(&(ch->q), payload);
+    pthread_cond_signal(&(ch->not_empty));
+    pthread_mutex_unlock(&(ch->lock));
+
+    return CHANNEL_SUCCESS;
+}
+
+void* channel_pop(channel* ch){
+
+    void* payload;
+
+    pthread_mutex_lock(&(ch->lock));
+    while(queue_is_empty(&(ch->q)) && ch->writers > 0){
+	pthread_cond_wait(&(ch->not_empty), &(ch->lock));
+    }
+    payload = queue_pop(&(ch->q));
+    if(payload){
+	pthread_cond_signal(&(ch->not_full));
+    }
+    pthread_mutex_unlock(&(ch->lock));
+
+    return payload;
+}
+
+void channel_close(channel* ch){
+
+    pthread_mutex_lock(&(ch->lock));
+    ch->writers--;
+    if(ch->writers <= 0){
+	/* let every reader see the end */
+	pthread_cond_broadcast(&(ch->not_empty));
+    }
+    pthread_mutex_unlock(&(ch->lock));
+}
+
+void channel_cleanup(channel* ch){
+
+    queue_cleanup(&(ch->q));
+    pthread_cond_destroy(&(ch->not_empty));
+    pthread_cond_destroy(&(ch->not_full));
+    pthread_mutex_destroy(&(ch->lock));
+}
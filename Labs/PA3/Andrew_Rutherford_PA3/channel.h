@@ -0,0 +1,53 @@
+/*
+ * File: channel.h
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	This is the header file for a bounded, blocking channel
+ *      built on the FIFO queue. It connects two pipeline stages:
+ *      pushes block while the channel is full, pops block while
+ *      it is empty, and pops return NULL once every writer has
+ *      closed its end and the channel has drained.
+ *
+ */
+
+#ifndef CHANNEL_H
+#define CHANNEL_H
+
+#include <pthread.h>
+
+#include "queue.h"
+
+#define CHANNEL_FAILURE -1
+#define CHANNEL_SUCCESS 0
+
+typedef struct channel_s{
+    queue q;
+    int writers;		/* writers that have not closed yet */
+    pthread_mutex_t lock;
+    pthread_cond_t not_full;
+    pthread_cond_t not_empty;
+} channel;
+
+/* Function to initilize a channel of size slots fed by writers threads
+ * On success, returns channel size
+ * On failure, returns CHANNEL_FAILURE
+ */
+int channel_init(channel* ch, int size, int writers);
+
+/* Function to add payload, waiting for room
+ * Returns CHANNEL_SUCCESS, or CHANNEL_FAILURE on a NULL payload
+ */
+int channel_push(channel* ch, void* payload);
+
+/* Function to take the oldest payload, waiting for one
+ * Returns NULL once all writers closed and the channel is empty
+ */
+void* channel_pop(channel* ch);
+
+/* Function for a writer to say it will push no more */
+void channel_close(channel* ch);
+
+/* Function to free channel memory */
+void channel_cleanup(channel* ch);
+
+#endif
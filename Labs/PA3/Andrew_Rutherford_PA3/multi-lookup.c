@@ -2,224 +2,390 @@
 
 #include "multi-lookup.h"
 
-pthread_cond_t full;
-pthread_cond_t empty;
-
-
-queue q;
-int FILES_FINISHED;
+// Bounded channels between the stages. Jobs come from a fixed
+// pool and go back to it once written, and the result cache holds
+// a fixed number of entries sized from that pool, so memory does
+// not grow with the input no matter which stage is slowest.
+channel free_jobs;
+channel parsed;
+channel resolved;
+
+cache results;
+stats counters;
+int REVERSE;
 int NUM_INPUT_FILES;
-char* OUT_FILE;
-int THREAD_MAX;
+char** INPUT_FILES;
+int NEXT_INPUT_FILE;
+FILE* OUT_FP;
 
-pthread_mutex_t queue_lock;
-pthread_mutex_t inc_lock;
 pthread_mutex_t out_lock;
+pthread_mutex_t cache_lock;
 
-void* read_file(char* filename)
+int parse_file(char* filename, int slot)
 {
     FILE* input = fopen(filename, "r");
 
     //If text file cannot be opened return error.
     if(!input){
         perror("Error opening input file.\n");
-        return NULL;
+        return 0;
     }
     char hostname[SBUFSIZE];
     int names_count = 0;
 
-    //Push hostname to queue while locked
+    //Hand each name to the resolvers, waiting for a free job if all are in flight
     while(fscanf(input, INPUTFS, hostname) > 0)
     {
-        pthread_mutex_lock(&queue_lock);
-
-        //See if there is space in the queue
-        while(queue_is_full(&q)){
-            fflush(stdout);
-            pthread_cond_wait(&full, &queue_lock);
-        }
+        lookup_job* job = channel_pop(&free_jobs);
 
-        queue_push(&q, strdup(hostname));
+        strcpy(job->name, hostname);
+        channel_push(&parsed, job);
 
-        pthread_cond_signal(&empty);
-        pthread_mutex_unlock(&queue_lock);
         names_count++;
+        stats_inc(&counters, slot, STAT_NAMES_READ);
+        stats_add(&counters, slot, STAT_BYTES_READ, strlen(hostname) + 1);
     }
 
-    //Increment counter
-    pthread_mutex_lock(&inc_lock);
-    FILES_FINISHED++;
-    pthread_mutex_unlock(&inc_lock);
-
     //Close file and return
     fclose(input);
-    printf("Requester thread added %d hostnames to queue.\n", names_count);
-    return NULL;
+    return names_count;
 }
 
-void* producer_pool(char* input_files)
+void* parse_stage()
 {
-    char** input_file_names = (char **) input_files;
-    pthread_t producer_threads[NUM_INPUT_FILES];
+    int slot = stats_claim(&counters);
+    int file;
 
-    //Thread pool for reading files
-    int i;
-    for (i=0 ; i < NUM_INPUT_FILES ; i++)
+    //Take the next unclaimed input file until none are left
+    while((file = __atomic_fetch_add(&NEXT_INPUT_FILE, 1, __ATOMIC_RELAXED)) < NUM_INPUT_FILES)
     {
-        char* input_file_name = input_file_names[i];
-        pthread_create(&producer_threads[i], NULL, (void*) read_file, (void*) input_file_name);
-        pthread_join(producer_threads[i], NULL);
-    }
+        int names_count = parse_file(INPUT_FILES[file], slot);
 
-    for(i=0 ; i < NUM_INPUT_FILES ; i++)
-    {
-        pthread_cond_signal(&empty);
+        printf("Requester thread added %d hostnames to queue.\n", names_count);
+        stats_inc(&counters, slot, STAT_FILES_FINISHED);
     }
 
+    channel_close(&parsed);
     return NULL;
 }
 
-void* resolve_dns()
+int lookup_name(const char* name, char* result, int maxSize, int slot)
 {
+    int type = REVERSE ? CACHE_REVERSE : CACHE_FORWARD;
+    int status;
 
-    FILE* out_fp =fopen(OUT_FILE, "w");
-    if(!out_fp)
+    //Answer repeated names from the cache
+    pthread_mutex_lock(&cache_lock);
+    if(cache_lookup(&results, type, name, result, maxSize, &status) == CACHE_SUCCESS)
     {
-        perror("Error opening output file");
-    return NULL;
+        pthread_mutex_unlock(&cache_lock);
+        stats_inc(&counters, slot, STAT_CACHED);
+        return status;
     }
+    pthread_mutex_unlock(&cache_lock);
 
-    while(1)
+    if(REVERSE)
     {
-        //Lock queue
-        pthread_mutex_lock(&queue_lock);
-
-        //Check if queue is empty
-        while(queue_is_empty(&q))
-        {
+        status = reverselookup(name, result, maxSize);
+    }
+    else
+    {
+        status = dnslookup(name, result, maxSize);
+    }
 
-            //Queue is empty
-            pthread_mutex_lock(&inc_lock);
-            int que_empty = 0;
-            if(FILES_FINISHED == NUM_INPUT_FILES){
-                que_empty = 1;
-            } 
-            pthread_mutex_unlock(&inc_lock);
+    if(status == UTIL_FAILURE)
+    {
+        strncpy(result, "", maxSize);
+    }
 
-            if (que_empty)
-            {
-                printf("All files have been processed.\n");
+    pthread_mutex_lock(&cache_lock);
+    cache_insert(&results, type, name, result, status);
+    pthread_mutex_unlock(&cache_lock);
 
-                //Drop lock before exiting
-                pthread_mutex_unlock(&queue_lock);
+    return status;
+}
 
-                return NULL;
-            }
+void* resolve_stage()
+{
+    int slot = stats_claim(&counters);
+    lookup_job* job;
 
-            //Wait until producers add something to the queue
-            pthread_cond_wait(&empty, &queue_lock);
+    //No lock is held while the lookup runs
+    while((job = channel_pop(&parsed)))
+    {
+        job->status = lookup_name(job->name, job->result, sizeof(job->result), slot);
 
+        if(job->status == UTIL_FAILURE)
+        {
+            fprintf(stderr, "DNS lookup error %s: %s\n",
+                    REVERSE ? "address" : "hostname", job->name);
+            stats_inc(&counters, slot, STAT_FAILED);
+        }
+        else
+        {
+            stats_inc(&counters, slot, STAT_RESOLVED);
         }
 
-        char* single_hostname = (char*) queue_pop(&q);
-        pthread_cond_signal(&full);
+        channel_push(&resolved, job);
+    }
 
-        char first_ip[INET6_ADDRSTRLEN];
+    channel_close(&resolved);
+    return NULL;
+}
 
-        if(dnslookup(single_hostname, first_ip, sizeof(first_ip)) == UTIL_FAILURE)
-        {
-            fprintf(stderr, "DNS lookup error hostname: %s\n", single_hostname);
-            strncpy(first_ip, "", sizeof(first_ip));
-        }
+void* write_stage()
+{
+    lookup_job* job;
 
+    while((job = channel_pop(&resolved)))
+    {
         //Print to file
         pthread_mutex_lock(&out_lock);
-        fprintf(out_fp, "%s, %s\n", single_hostname, first_ip);
-        // printf("%s, %s\n", single_hostname, first_ip);
+        fprintf(OUT_FP, "%s, %s\n", job->name, job->result);
         pthread_mutex_unlock(&out_lock);
 
-        //Prevent memory leaks
-        free(single_hostname);
-
-        //Unlock queue
-        pthread_mutex_unlock(&queue_lock);
-
+        //Recycle the job for the parsers; never blocks, see main
+        channel_push(&free_jobs, job);
     }
 
-    fclose(out_fp);
-
     return NULL;
 }
 
-void* consumer_pool()
+void drain_channel(channel* ch)
 {
-    pthread_t consumer_threads[NUM_INPUT_FILES];
+    lookup_job* job;
 
-    //Thread pool for reading files
-    int i;
-    for (i=0; i < THREAD_MAX ; i++)
+    //Throw away whatever is left and recycle the jobs. free_jobs has
+    //room for all pool_size jobs there are, so these pushes never
+    //block, even once no parser is left to take jobs out
+    while((job = channel_pop(ch)))
     {
-        pthread_create(&consumer_threads[i], NULL, resolve_dns, NULL);
-        pthread_join(consumer_threads[i], NULL);
+        channel_push(&free_jobs, job);
     }
-
-    return NULL;
 }
 
 int main(int argc, char* argv[])
 {
-    FILES_FINISHED = 0;
-    NUM_INPUT_FILES = argc - 2;
-    char* input_files[NUM_INPUT_FILES];
+    REVERSE = 0;
+    char* progress_path = NULL;
+    int parse_threads = 0;
+    int resolve_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    int write_threads = 1;
+    const char* threads_from = "one parser per input file, resolvers from _SC_NPROCESSORS_ONLN, one writer";
+    int depth = CHANNEL_DEPTH;
+    int replay = REPLAY_OFF;
+    char* replay_path = NULL;
+    double latency_scale = 1.0;
+
+    //Leading options
+    int first_arg = 1;
+    while(first_arg < argc && argv[first_arg][0] == '-')
+    {
+        if(!strcmp(argv[first_arg], "-r"))
+        {
+            REVERSE = 1;
+        }
+        else if(!strcmp(argv[first_arg], "-p") && first_arg + 1 < argc)
+        {
+            progress_path = argv[++first_arg];
+        }
+        else if(!strcmp(argv[first_arg], "-t") && first_arg + 1 < argc &&
+                sscanf(argv[first_arg + 1], "%d,%d,%d",
+                       &parse_threads, &resolve_threads, &write_threads) == 3 &&
+                parse_threads > 0 && resolve_threads > 0 && write_threads > 0)
+        {
+            threads_from = "-t";
+            first_arg++;
+        }
+        else if(!strcmp(argv[first_arg], "-d") && first_arg + 1 < argc &&
+                sscanf(argv[first_arg + 1], "%d", &depth) == 1 && depth > 0)
+        {
+            first_arg++;
+        }
+        else if((!strcmp(argv[first_arg], "-R") || !strcmp(argv[first_arg], "-P")) &&
+                first_arg + 1 < argc)
+        {
+            replay = argv[first_arg][1] == 'R' ? REPLAY_RECORD : REPLAY_REPLAY;
+            replay_path = argv[++first_arg];
+        }
+        else if(!strcmp(argv[first_arg], "-S") && first_arg + 1 < argc &&
+                sscanf(argv[first_arg + 1], "%lf", &latency_scale) == 1 && latency_scale >= 0)
+        {
+            first_arg++;
+        }
+        else
+        {
+            fprintf(stderr, "Unknown option: %s\n", argv[first_arg]);
+            fprintf(stderr, "Using:\n %s %s\n", argv[0], USAGE);
+            return EXIT_FAILURE;
+        }
+        first_arg++;
+    }
 
-    //Where output is written to
-    OUT_FILE = argv[argc-1];
-    THREAD_MAX = sysconf(_SC_NPROCESSORS_ONLN);
+    //Check number of arguments
+    if(argc - first_arg + 1 < MINARGS)
+    {
+        fprintf(stderr, "Not enough arguments: %d\n", (argc - first_arg));
+        fprintf(stderr, "Using:\n %s %s\n", argv[0], USAGE);
+        return EXIT_FAILURE;
+    }
 
-    printf("Resolving threads from _SC_NPROCESSORS_ONLN, set to %d\n",THREAD_MAX);
+    NUM_INPUT_FILES = argc - first_arg - 1;
+    INPUT_FILES = argv + first_arg;
+    NEXT_INPUT_FILE = 0;
+
+    //One parser per file unless told otherwise
+    if(parse_threads == 0)
+    {
+        parse_threads = NUM_INPUT_FILES;
+    }
+
+    printf("Threads: %d parse, %d resolve, %d write (%s)\n",
+           parse_threads, resolve_threads, write_threads, threads_from);
 
     fflush(stdout);
 
-    queue_init(&q, 16);
-    pthread_cond_init(&empty, NULL);
-    pthread_cond_init(&full, NULL);
-    pthread_mutex_init(&queue_lock, NULL);
-    pthread_mutex_init(&inc_lock, NULL);
-    pthread_mutex_init(&out_lock, NULL);
+    //Record live lookups, or replay them without touching the network
+    if(replay != REPLAY_OFF && replay_init(replay, replay_path, latency_scale) == REPLAY_FAILURE)
+    {
+        return EXIT_FAILURE;
+    }
 
-    //Check number of arguments
-    if(argc < MINARGS)
+    //Where output is written to
+    OUT_FP = fopen(argv[argc-1], "w");
+    if(!OUT_FP)
     {
-        fprintf(stderr, "Not enough arguments: %d\n", (argc - 1));
-        fprintf(stderr, "Using:\n %s %s\n", argv[0], USAGE);
+        perror("Error opening output file");
+        return EXIT_FAILURE;
+    }
+
+    //Enough jobs to fill both channels and keep every thread busy
+    int pool_size = 2 * depth + parse_threads + resolve_threads + write_threads;
+    lookup_job* pool = malloc(sizeof(lookup_job) * pool_size);
+    if(!pool)
+    {
+        perror("Error on job Malloc");
         return EXIT_FAILURE;
     }
 
-    //Extract filenames from argv
+    //free_jobs holds the whole pool, so recycling a job never blocks
+    if(channel_init(&free_jobs, pool_size, 0) == CHANNEL_FAILURE ||
+       channel_init(&parsed, depth, parse_threads) == CHANNEL_FAILURE ||
+       channel_init(&resolved, depth, resolve_threads) == CHANNEL_FAILURE)
+    {
+        return EXIT_FAILURE;
+    }
+    if(cache_init(&results, CACHE_ENTRIES_PER_JOB * pool_size,
+                  CACHE_ENTRIES_PER_JOB * pool_size) == CACHE_FAILURE)
+    {
+        return EXIT_FAILURE;
+    }
+    if(stats_init(&counters, parse_threads + resolve_threads) == STATS_FAILURE)
+    {
+        return EXIT_FAILURE;
+    }
+    pthread_mutex_init(&out_lock, NULL);
+    pthread_mutex_init(&cache_lock, NULL);
+
     int i;
+    for (i=0 ; i < pool_size ; i++)
+    {
+        channel_push(&free_jobs, &pool[i]);
+    }
+
+    //Size of all inputs, for the progress estimate
+    unsigned long input_bytes = 0;
     for (i=0 ; i < NUM_INPUT_FILES ; i++)
     {
-        input_files[i] = argv[i+1];
+        struct stat input_stat;
+
+        if(!stat(INPUT_FILES[i], &input_stat))
+        {
+            input_bytes += input_stat.st_size;
+        }
+    }
+
+    //Live progress for long runs
+    progress reporter;
+    int reporting = progress_path &&
+        progress_start(&reporter, &counters, progress_path, input_bytes) == PROGRESS_SUCCESS;
+
+    //Start every stage
+    int nthreads = parse_threads + resolve_threads + write_threads;
+    pthread_t threads[nthreads];
+    int started;
+    for (started=0 ; started < nthreads ; started++)
+    {
+        void* (*stage)() = started < parse_threads ? parse_stage :
+            started < parse_threads + resolve_threads ? resolve_stage : write_stage;
+
+        if(pthread_create(&threads[started], NULL, stage, NULL))
+        {
+            perror("Error creating thread");
+            break;
+        }
+    }
+
+    //A thread failed to start: stop reading input, close the ends
+    //the missing threads would have closed, and drain the first
+    //stage nothing is left to read so the started threads can finish
+    if(started < nthreads)
+    {
+        __atomic_store_n(&NEXT_INPUT_FILE, NUM_INPUT_FILES, __ATOMIC_RELAXED);
+        for (i=started ; i < parse_threads ; i++)
+        {
+            channel_close(&parsed);
+        }
+        for (i=started > parse_threads ? started : parse_threads ;
+             i < parse_threads + resolve_threads ; i++)
+        {
+            channel_close(&resolved);
+        }
+        if(started <= parse_threads)
+        {
+            drain_channel(&parsed);
+        }
+        else if(started <= parse_threads + resolve_threads)
+        {
+            drain_channel(&resolved);
+        }
     }
 
-    //IDs for consumer and producer threads
-    pthread_t producer_id, consumer_id;
+    for (i=0 ; i < started ; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    if(started < nthreads)
+    {
+        fprintf(stderr, "Started %d of %d threads, stopped early.\n", started, nthreads);
+    }
+    else
+    {
+        printf("All files have been processed.\n");
+    }
 
-    //Start producer thread pool
-    int producer = pthread_create(&producer_id, NULL, (void*) producer_pool, input_files);
-    
-    //Start consumer thread pool
-    int consumer = pthread_create(&consumer_id, NULL, (void*) consumer_pool, NULL);
+    if(reporting)
+    {
+        progress_stop(&reporter);
+    }
 
-    if(producer || consumer) printf("error\n");
-    pthread_join(consumer_id, NULL);
-    pthread_join(producer_id, NULL);
+    printf("Resolved %lu names from %lu files: %lu failed, %lu answered from cache.\n",
+           stats_read(&counters, STAT_RESOLVED) + stats_read(&counters, STAT_FAILED),
+           stats_read(&counters, STAT_FILES_FINISHED),
+           stats_read(&counters, STAT_FAILED),
+           stats_read(&counters, STAT_CACHED));
 
     //Cleanup
-    queue_cleanup(&q);
+    fclose(OUT_FP);
+    replay_cleanup();
+    channel_cleanup(&resolved);
+    channel_cleanup(&parsed);
+    channel_cleanup(&free_jobs);
+    free(pool);
+    cache_cleanup(&results);
+    stats_cleanup(&counters);
+    pthread_mutex_destroy(&cache_lock);
     pthread_mutex_destroy(&out_lock);
-    pthread_mutex_destroy(&queue_lock);
-    pthread_mutex_destroy(&inc_lock);
 
-    return EXIT_SUCCESS;
-}
\ No newline at end of file
+    return started < nthreads ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -10,27 +10,53 @@
 #include <stdio.h>
 #include <errno.h>
 #include <unistd.h>
+#include <sys/stat.h>
 #include "util.h"
+#include "replay.h"
 #include "queue.h"
+#include "channel.h"
+#include "cache.h"
+#include "stats.h"
+#include "progress.h"
 
 #define MINARGS 3
-#define USAGE "<inputFilePath> <outputFilePath>"
+#define USAGE "[-r] [-p <progressFilePath>] [-t <parse>,<resolve>,<write>] [-d <channelDepth>] [-R <recordFilePath> | -P <replayFilePath> [-S <latencyScale>]] <inputFilePath> <outputFilePath>"
 #define SBUFSIZE 1025
 #define INPUTFS "%1024s"
 
-// Producer hostname push
-void* read_file(char* filename);
+// Default slots in each channel between stages
+#define CHANNEL_DEPTH 16
 
-// Pool for producers, thread creation
-void* producer_pool(char* input_files);
+// Results the cache keeps per job in the pool before evicting
+#define CACHE_ENTRIES_PER_JOB 64
 
-// resolve dns
-void* resolve_dns();
+// One name moving through the pipeline
+typedef struct lookup_job_s{
+    char name[SBUFSIZE];
+    char result[SBUFSIZE];
+    int status;
+} lookup_job;
 
-// Pool for consumers, thread creation
-void* consumer_pool();
+// Parse stage: read names from input files into jobs
+void* parse_stage();
+
+// Parse one input file, returns number of names read
+int parse_file(char* filename, int slot);
+
+// Resolve one name (or address in reverse mode) through the cache
+int lookup_name(const char* name, char* result, int maxSize, int slot);
+
+// Resolve stage: look up jobs from the parse channel
+void* resolve_stage();
+
+// Write stage: format results and recycle jobs
+void* write_stage();
+
+// Discard what is left in a channel, recycling the jobs
+// Relies on free_jobs having room for every job in the pool
+void drain_channel(channel* ch);
 
 // main
 int main(int argc, char* argv[]);
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,149 @@
+/*
+ * File: progress.c
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	This file contains the live progress reporter.
+ *
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "progress.h"
+
+static double seconds_between(const struct timespec* a, const struct timespec* b){
+    return (b->tv_sec - a->tv_sec) + (b->tv_nsec - a->tv_nsec) / 1e9;
+}
+
+static void progress_write(progress* p, int final){
+
+    struct timespec now;
+    unsigned long names_read, bytes_read, files_finished, resolved, failed, cached;
+    unsigned long finished, total;
+    double interval, rate, average, speed, eta;
+    char tmp_path[strlen(p->path) + 5];
+    FILE* out;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    /* Totals are read without stopping anyone, so they may be a
+     * tick apart from each other; fine for a progress report */
+    names_read = stats_read(p->counters, STAT_NAMES_READ);
+    bytes_read = stats_read(p->counters, STAT_BYTES_READ);
+    files_finished = stats_read(p->counters, STAT_FILES_FINISHED);
+    resolved = stats_read(p->counters, STAT_RESOLVED);
+    failed = stats_read(p->counters, STAT_FAILED);
+    cached = stats_read(p->counters, STAT_CACHED);
+    finished = resolved + failed;
+
+    /* current rate over the last interval, average over the run */
+    interval = seconds_between(&(p->last), &now);
+    rate = interval > 0 ? (finished - p->last_finished) / interval : 0;
+    average = seconds_between(&(p->start), &now);
+    average = average > 0 ? finished / average : 0;
+    p->last = now;
+    p->last_finished = finished;
+
+    /* scale names seen so far by how much of the input was read */
+    if(final || bytes_read == 0 || bytes_read >= p->total_bytes){
+	total = names_read;
+    }
+    else{
+	total = (unsigned long) ((double) names_read * p->total_bytes / bytes_read);
+    }
+    if(total < finished){
+	total = finished;
+    }
+    speed = rate > 0 ? rate : average;
+    eta = speed > 0 ? (total - finished) / speed : -1;
+
+    /* write aside and rename so readers never see a partial file */
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", p->path);
+    out = fopen(tmp_path, "w");
+    if(!out){
+	perror("Error opening progress file");
+	return;
+    }
+    fprintf(out, "state: %s\n", final ? "done" : "running");
+    fprintf(out, "elapsed: %.1f\n", seconds_between(&(p->start), &now));
+    fprintf(out, "names_read: %lu\n", names_read);
+    fprintf(out, "files_finished: %lu\n", files_finished);
+    fprintf(out, "resolved: %lu\n", resolved);
+    fprintf(out, "failed: %lu\n", failed);
+    fprintf(out, "cached: %lu\n", cached);
+    fprintf(out, "estimated_total: %lu\n", total);
+    fprintf(out, "rate: %.1f\n", rate);
+    fprintf(out, "average_rate: %.1f\n", average);
+    if(eta >= 0){
+	fprintf(out, "eta: %.1f\n", eta);
+    }
+    else{
+	fprintf(out, "eta: unknown\n");
+    }
+    fclose(out);
+
+    if(rename(tmp_path, p->path)){
+	perror("Error renaming progress file");
+    }
+}
+
+static void* progress_run(void* arg){
+
+    progress* p = arg;
+    struct timespec deadline;
+
+    pthread_mutex_lock(&(p->lock));
+    while(!p->done){
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += PROGRESS_INTERVAL;
+	pthread_cond_timedwait(&(p->wake), &(p->lock), &deadline);
+	if(!p->done){
+	    pthread_mutex_unlock(&(p->lock));
+	    progress_write(p, 0);
+	    pthread_mutex_lock(&(p->lock));
+	}
+    }
+    pthread_mutex_unlock(&(p->lock));
+
+    return NULL;
+}
+
+int progress_start(progress* p, stats* counters,
+		   const char* path, unsigned long total_bytes){
+
+    p->counters = counters;
+    p->path = path;
+    p->total_bytes = total_bytes;
+    p->done = 0;
+    p->last_finished = 0;
+    clock_gettime(CLOCK_MONOTONIC, &(p->start));
+    p->last = p->start;
+    pthread_mutex_init(&(p->lock), NULL);
+    pthread_cond_init(&(p->wake), NULL);
+
+    progress_write(p, 0);
+
+    if(pthread_create(&(p->thread), NULL, progress_run, p)){
+	fprintf(stderr, "Error starting progress thread\n");
+	pthread_cond_destroy(&(p->wake));
+	pthread_mutex_destroy(&(p->lock));
+	return PROGRESS_FAILURE;
+    }
+
+    return PROGRESS_SUCCESS;
+}
+
+void progress_stop(progress* p){
+
+    pthread_mutex_lock(&(p->lock));
+    p->done = 1;
+    pthread_cond_signal(&(p->wake));
+    pthread_mutex_unlock(&(p->lock));
+    pthread_join(p->thread, NULL);
+
+    progress_write(p, 1);
+
+    pthread_cond_destroy(&(p->wake));
+    pthread_mutex_destroy(&(p->lock));
+}
@@ -0,0 +1,50 @@
+/*
+ * File: progress.h
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	This is the header file for the live progress reporter.
+ *      A background thread periodically rewrites a small stats
+ *      file from the per-thread counters in stats.h, so a long
+ *      run can be watched with e.g. "watch cat <file>".
+ *
+ */
+
+#ifndef PROGRESS_H
+#define PROGRESS_H
+
+#include <pthread.h>
+#include <time.h>
+
+#include "stats.h"
+
+#define PROGRESS_FAILURE -1
+#define PROGRESS_SUCCESS 0
+
+/* Seconds between rewrites of the stats file */
+#define PROGRESS_INTERVAL 1
+
+typedef struct progress_s{
+    stats* counters;
+    const char* path;
+    unsigned long total_bytes;	/* size of all inputs, for the estimate */
+    int done;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    struct timespec start;
+    struct timespec last;
+    unsigned long last_finished;
+} progress;
+
+/* Function to start reporting progress to path
+ * total_bytes is the combined size of the inputs,
+ * used to estimate the number of names left.
+ * Returns PROGRESS_SUCCESS or PROGRESS_FAILURE
+ */
+int progress_start(progress* p, stats* counters,
+		   const char* path, unsigned long total_bytes);
+
+/* Function to write a final report and stop the reporter */
+void progress_stop(progress* p);
+
+#endif
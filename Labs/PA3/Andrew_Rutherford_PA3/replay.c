@@ -0,0 +1,216 @@
+/*
+ * File: replay.c
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	This file contains the lookup record/replay layer.
+ *      Recordings are text, one lookup per line:
+ *          <kind> <status> <latency usec> <name> <answer or ->
+ *
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "replay.h"
+
+#define REPLAY_FIELDFS "%1024s"
+#define REPLAY_FIELDSIZE 1025
+
+typedef struct replay_record_s{
+    int type;
+    int status;
+    long latency;
+    char* key;
+    char* value;
+    int line;			/* position in the file, for ties */
+} replay_record;
+
+static int mode = REPLAY_OFF;
+static double latency_scale = 1.0;
+
+/* record mode */
+static FILE* record_fp = NULL;
+static pthread_mutex_t record_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* replay mode: records sorted by kind, name and line */
+static replay_record* records = NULL;
+static int nrecords = 0;
+
+static int replay_compare_name(const void* a, const void* b){
+
+    const replay_record* ra = a;
+    const replay_record* rb = b;
+
+    if(ra->type != rb->type){
+	return ra->type - rb->type;
+    }
+    return strcmp(ra->key, rb->key);
+}
+
+/* qsort is not stable, so recordings of one name keep
+ * their file order by line */
+static int replay_compare(const void* a, const void* b){
+
+    const replay_record* ra = a;
+    const replay_record* rb = b;
+    int c = replay_compare_name(a, b);
+
+    if(c){
+	return c;
+    }
+    return (ra->line > rb->line) - (ra->line < rb->line);
+}
+
+static int replay_load(const char* path){
+
+    FILE* fp = fopen(path, "r");
+    replay_record r;
+    char key[REPLAY_FIELDSIZE];
+    char value[REPLAY_FIELDSIZE];
+    replay_record* grown;
+    int size = 0;
+
+    if(!fp){
+	perror("Error opening replay file");
+	return REPLAY_FAILURE;
+    }
+
+    while(fscanf(fp, "%d %d %ld " REPLAY_FIELDFS " " REPLAY_FIELDFS,
+		 &r.type, &r.status, &r.latency, key, value) == 5){
+	if(nrecords == size){
+	    size = size ? 2 * size : 1024;
+	    grown = realloc(records, sizeof(replay_record) * size);
+	    if(!grown){
+		perror("Error on replay Malloc");
+		fclose(fp);
+		replay_cleanup();
+		return REPLAY_FAILURE;
+	    }
+	    records = grown;
+	}
+	r.key = strdup(key);
+	r.value = strdup(strcmp(value, "-") ? value : "");
+	r.line = nrecords;
+	if(!(r.key) || !(r.value)){
+	    perror("Error on replay Malloc");
+	    free(r.key);
+	    free(r.value);
+	    fclose(fp);
+	    replay_cleanup();
+	    return REPLAY_FAILURE;
+	}
+	records[nrecords++] = r;
+    }
+    fclose(fp);
+
+    /* sorted for lookups; the first recording of a name wins */
+    qsort(records, nrecords, sizeof(replay_record), replay_compare);
+
+    return REPLAY_SUCCESS;
+}
+
+int replay_init(int new_mode, const char* path, double scale){
+
+    latency_scale = scale;
+
+    if(new_mode == REPLAY_RECORD){
+	record_fp = fopen(path, "w");
+	if(!record_fp){
+	    perror("Error opening record file");
+	    return REPLAY_FAILURE;
+	}
+    }
+    else if(new_mode == REPLAY_REPLAY){
+	if(replay_load(path) == REPLAY_FAILURE){
+	    return REPLAY_FAILURE;
+	}
+    }
+
+    mode = new_mode;
+
+    return REPLAY_SUCCESS;
+}
+
+int replay_mode(void){
+    return mode;
+}
+
+static void replay_wait(long latency){
+
+    struct timespec delay;
+    double usec = latency * latency_scale;
+
+    if(usec <= 0){
+	return;
+    }
+    delay.tv_sec = (time_t) (usec / 1000000);
+    delay.tv_nsec = (long) ((usec - delay.tv_sec * 1000000.0) * 1000);
+    nanosleep(&delay, NULL);
+}
+
+int replay_find(int type, const char* key, char* value, int maxSize){
+
+    replay_record want;
+    replay_record* found;
+    unsigned long h = 5381;
+    const char* c;
+
+    want.type = type;
+    want.key = (char*) key;
+    found = bsearch(&want, records, nrecords,
+		    sizeof(replay_record), replay_compare_name);
+
+    if(found){
+	/* back up to the first recording of this name */
+	while(found > records && !replay_compare_name(found - 1, &want)){
+	    found--;
+	}
+	replay_wait(found->latency);
+	strncpy(value, found->value, maxSize);
+	value[maxSize-1] = '\0';
+	return found->status;
+    }
+
+    /* unknown name: fail, paying a latency picked
+     * deterministically from the recorded ones */
+    if(nrecords > 0){
+	for(c = key; *c; c++){
+	    h = ((h << 5) + h) + (unsigned char) *c;
+	}
+	replay_wait(records[h % nrecords].latency);
+    }
+    fprintf(stderr, "Name not in replay file: %s\n", key);
+    strncpy(value, "", maxSize);
+
+    return REPLAY_FAILURE;
+}
+
+void replay_save(int type, const char* key, const char* value,
+		 int status, long latency){
+
+    pthread_mutex_lock(&record_lock);
+    fprintf(record_fp, "%d %d %ld %s %s\n", type, status, latency,
+	    key, (value && value[0]) ? value : "-");
+    pthread_mutex_unlock(&record_lock);
+}
+
+void replay_cleanup(void){
+
+    int i;
+
+    if(record_fp){
+	fclose(record_fp);
+	record_fp = NULL;
+    }
+    for(i=0; i < nrecords; ++i){
+	free(records[i].key);
+	free(records[i].value);
+    }
+    free(records);
+    records = NULL;
+    nrecords = 0;
+    mode = REPLAY_OFF;
+}
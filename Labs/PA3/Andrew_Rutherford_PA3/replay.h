@@ -0,0 +1,53 @@
+/*
+ * File: replay.h
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	This is the header file for the lookup record/replay layer
+ *      used underneath dnslookup() and reverselookup(). Record mode
+ *      appends every live answer and its latency to a file; replay
+ *      mode answers from that file instead of the network, sleeping
+ *      for the recorded (optionally scaled) latency, so resolver
+ *      runs can be benchmarked offline and reproduced exactly.
+ *
+ */
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#define REPLAY_FAILURE -1
+#define REPLAY_SUCCESS 0
+
+/* Modes */
+#define REPLAY_OFF 0
+#define REPLAY_RECORD 1
+#define REPLAY_REPLAY 2
+
+/* Kinds of lookups recorded */
+#define REPLAY_FORWARD 0
+#define REPLAY_REVERSE 1
+
+/* Function to start recording to or replaying from path
+ * scale multiplies replayed latencies (0 disables sleeping)
+ * Returns REPLAY_SUCCESS or REPLAY_FAILURE
+ */
+int replay_init(int mode, const char* path, double scale);
+
+/* Function to return the current mode */
+int replay_mode(void);
+
+/* Function to answer a lookup from the recording
+ * Copies the recorded answer to value of size maxSize after
+ * waiting out its latency, and returns the recorded status.
+ * Names missing from the recording fail after a latency drawn
+ * from the recorded distribution.
+ */
+int replay_find(int type, const char* key, char* value, int maxSize);
+
+/* Function to append a live answer and its latency in microseconds */
+void replay_save(int type, const char* key, const char* value,
+		 int status, long latency);
+
+/* Function to flush and free replay state */
+void replay_cleanup(void);
+
+#endif
@@ -0,0 +1,73 @@
+/*
+ * File: stats.c
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	This file contains an implementation of per-thread
+ *      progress counters aggregated on read.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "stats.h"
+
+int stats_init(stats* s, int nslots){
+
+    if(nslots < 1){
+	nslots = 1;
+    }
+
+    /* one cache line (or more) per slot */
+    if(posix_memalign((void**) &(s->slots), STATS_CACHELINE,
+		      sizeof(stats_slot) * nslots)){
+	perror("Error on stats Malloc");
+	return STATS_FAILURE;
+    }
+    memset(s->slots, 0, sizeof(stats_slot) * nslots);
+
+    s->nslots = nslots;
+    s->nclaimed = 0;
+
+    return s->nslots;
+}
+
+int stats_claim(stats* s){
+
+    int slot = __atomic_fetch_add(&(s->nclaimed), 1, __ATOMIC_RELAXED);
+
+    if(slot >= s->nslots){
+	return STATS_FAILURE;
+    }
+
+    return slot;
+}
+
+void stats_inc(stats* s, int slot, stat_counter c){
+    stats_add(s, slot, c, 1);
+}
+
+void stats_add(stats* s, int slot, stat_counter c, unsigned long n){
+
+    unsigned long* p = &(s->slots[slot].count[c]);
+
+    /* single writer: a plain add, published with a relaxed store */
+    __atomic_store_n(p, *p + n, __ATOMIC_RELAXED);
+}
+
+unsigned long stats_read(stats* s, stat_counter c){
+
+    int i;
+    unsigned long total = 0;
+
+    for(i=0; i < s->nslots; ++i){
+	total += __atomic_load_n(&(s->slots[i].count[c]), __ATOMIC_RELAXED);
+    }
+
+    return total;
+}
+
+void stats_cleanup(stats* s)
+{
+    free(s->slots);
+}
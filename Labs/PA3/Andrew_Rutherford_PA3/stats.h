@@ -0,0 +1,72 @@
+/*
+ * File: stats.h
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	This is the header file for per-thread progress counters.
+ *      Every thread claims its own cache-line-sized slot and is the
+ *      only writer of it, so bumping a counter never takes a lock
+ *      or bounces a cache line. Readers sum all slots.
+ *
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+
+#define STATS_FAILURE -1
+#define STATS_SUCCESS 0
+
+#define STATS_CACHELINE 64
+
+typedef enum {
+    STAT_NAMES_READ,
+    STAT_BYTES_READ,
+    STAT_FILES_FINISHED,
+    STAT_RESOLVED,
+    STAT_FAILED,
+    STAT_CACHED,
+    STAT_COUNTERS
+} stat_counter;
+
+typedef struct stats_slot_s{
+    unsigned long count[STAT_COUNTERS];
+} __attribute__((aligned(STATS_CACHELINE))) stats_slot;
+
+typedef struct stats_s{
+    stats_slot* slots;
+    int nslots;
+    int nclaimed;
+} stats;
+
+/* Function to initilize counters for nslots threads
+ * On success, returns number of slots
+ * On failure, returns STATS_FAILURE
+ * Must be called before stats are used
+ */
+int stats_init(stats* s, int nslots);
+
+/* Function to claim a slot for the calling thread
+ * Returns the slot index, or STATS_FAILURE if all are taken
+ */
+int stats_claim(stats* s);
+
+/* Function to add one to counter c of slot
+ * Only the thread owning slot may call this
+ */
+void stats_inc(stats* s, int slot, stat_counter c);
+
+/* Function to add n to counter c of slot
+ * Only the thread owning slot may call this
+ */
+void stats_add(stats* s, int slot, stat_counter c, unsigned long n);
+
+/* Function to read counter c summed over all slots
+ * Safe to call from any thread at any time
+ */
+unsigned long stats_read(stats* s, stat_counter c);
+
+/* Function to free stats memory */
+void stats_cleanup(stats* s);
+
+#endif
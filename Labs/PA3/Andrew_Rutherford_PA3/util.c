@@ -10,9 +10,12 @@
  *  
  */
 
+#include <time.h>
+
 #include "util.h"
+#include "replay.h"
 
-int dnslookup(const char* hostname, char* firstIPstr, int maxSize){
+static int dnslookup_live(const char* hostname, char* firstIPstr, int maxSize){
 
     /* Local vars */
     struct addrinfo* headresult = NULL;
@@ -81,3 +84,88 @@ int dnslookup(const char* hostname, char* firstIPstr, int maxSize){
 
     return UTIL_SUCCESS;
 }
+
+static int reverselookup_live(const char* ipstr, char* hostname, int maxSize){
+
+    /* Local vars */
+    struct sockaddr_storage addr;
+    struct sockaddr_in* ipv4sock = (struct sockaddr_in*) &addr;
+    struct sockaddr_in6* ipv6sock = (struct sockaddr_in6*) &addr;
+    socklen_t addrlen = 0;
+    int addrError = 0;
+
+    /* DEBUG: Print Address*/
+#ifdef UTIL_DEBUG
+    fprintf(stderr, "%s\n", ipstr);
+#endif
+
+    /* Convert String to Address */
+    memset(&addr, 0, sizeof(addr));
+    if(inet_pton(AF_INET, ipstr, &(ipv4sock->sin_addr)) == 1){
+	ipv4sock->sin_family = AF_INET;
+	addrlen = sizeof(*ipv4sock);
+    }
+    else if(inet_pton(AF_INET6, ipstr, &(ipv6sock->sin6_addr)) == 1){
+	ipv6sock->sin6_family = AF_INET6;
+	addrlen = sizeof(*ipv6sock);
+    }
+    else{
+	fprintf(stderr, "Error Converting String to IP: %s\n", ipstr);
+	return UTIL_FAILURE;
+    }
+
+    /* Lookup Address */
+    addrError = getnameinfo((struct sockaddr*) &addr, addrlen,
+			    hostname, maxSize, NULL, 0, NI_NAMEREQD);
+    if(addrError){
+	fprintf(stderr, "Error looking up Hostname: %s\n",
+		gai_strerror(addrError));
+	return UTIL_FAILURE;
+    }
+    hostname[maxSize-1] = '\0';
+
+#ifdef UTIL_DEBUG
+    fprintf(stdout, "%s\n", hostname);
+#endif
+
+    return UTIL_SUCCESS;
+}
+
+/* Answer from the replay file, or do the live lookup
+ * and record it along with how long it took */
+static int recorded_lookup(int type,
+			   int (*live)(const char*, char*, int),
+			   const char* name, char* result, int maxSize){
+
+    struct timespec start;
+    struct timespec end;
+    long latency;
+    int status;
+
+    if(replay_mode() == REPLAY_REPLAY){
+	return replay_find(type, name, result, maxSize);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    status = live(name, result, maxSize);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    if(replay_mode() == REPLAY_RECORD){
+	latency = (end.tv_sec - start.tv_sec) * 1000000L
+	    + (end.tv_nsec - start.tv_nsec) / 1000;
+	replay_save(type, name, status == UTIL_SUCCESS ? result : "",
+		    status, latency);
+    }
+
+    return status;
+}
+
+int dnslookup(const char* hostname, char* firstIPstr, int maxSize){
+    return recorded_lookup(REPLAY_FORWARD, dnslookup_live,
+			   hostname, firstIPstr, maxSize);
+}
+
+int reverselookup(const char* ipstr, char* hostname, int maxSize){
+    return recorded_lookup(REPLAY_REVERSE, reverselookup_live,
+			   ipstr, hostname, maxSize);
+}
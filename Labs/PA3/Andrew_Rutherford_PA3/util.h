@@ -37,4 +37,12 @@ int dnslookup(const char* hostname,
 	      char* firstIPstr,
 	      int maxSize);
 
+/* Fuction to return the host name registered for
+ * the IPv4 or IPv6 address in ipstr. Name returned
+ * as string hostname of size maxsize
+ */
+int reverselookup(const char* ipstr,
+		  char* hostname,
+		  int maxSize);
+
 #endif
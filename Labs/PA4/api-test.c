@@ -19,6 +19,62 @@
 #include "simulator.h"
 
 #define MAXITERATIONS 5
+#define RANGEPAGE 1  /* first page of the pagein_range()/pageout_range() test */
+#define RANGELEN 3   /* pages in it */
+
+/* count of pages RANGEPAGE to RANGEPAGE+RANGELEN-1 of proc swapped in */
+static int rangein(Pentry q[MAXPROCESSES], int proc){
+    int page;
+    int n = 0;
+
+    for(page = RANGEPAGE; page < RANGEPAGE + RANGELEN; page++){
+	n += q[proc].pages[page] != 0;
+    }
+    return n;
+}
+
+/* After the single page test: page a run in, check whether it needs
+ * writing, then page it out. Returns 1 once the run is out again */
+static int rangetest(Pentry q[MAXPROCESSES], int tick){
+    static int step = 0;
+    int testProc = 0;
+    int ret;
+
+    switch(step){
+    case 0:
+	ret = pagein_range(testProc, RANGEPAGE, RANGELEN);
+	fprintf(stdout, "%4d - pagein_range(%d, %d, %d) returns %d\n",
+		tick, testProc, RANGEPAGE, RANGELEN, ret);
+	ret = pagein_range(testProc, RANGEPAGE, RANGELEN);
+	fprintf(stdout, "%4d - pagein_range(%d, %d, %d) again returns %d\n",
+		tick, testProc, RANGEPAGE, RANGELEN, ret);
+	step = 1;
+	break;
+    case 1:
+	if(rangein(q, testProc) < RANGELEN){
+	    break;
+	}
+	fprintf(stdout, "%4d - %d:%d-%d are swapped in\n",
+		tick, testProc, RANGEPAGE, RANGEPAGE + RANGELEN - 1);
+	fprintf(stdout, "%4d - pagedirty(%d, %d) returns %d\n",
+		tick, testProc, RANGEPAGE, pagedirty(testProc, RANGEPAGE));
+	fprintf(stdout, "%4d - pagedirty(%d, %d) returns %d\n",
+		tick, testProc, -1, pagedirty(testProc, -1));
+	ret = pageout_range(testProc, RANGEPAGE, RANGELEN);
+	fprintf(stdout, "%4d - pageout_range(%d, %d, %d) returns %d\n",
+		tick, testProc, RANGEPAGE, RANGELEN, ret);
+	step = 2;
+	break;
+    case 2:
+	if(rangein(q, testProc) > 0){
+	    break;
+	}
+	fprintf(stdout, "%4d - %d:%d-%d are swapped out\n",
+		tick, testProc, RANGEPAGE, RANGEPAGE + RANGELEN - 1);
+	return 1;
+    }
+    return 0;
+}
 
 void pageit(Pentry q[MAXPROCESSES]) { 
     
@@ -33,6 +89,16 @@ void pageit(Pentry q[MAXPROCESSES]) {
     int testPage = 0;
     int pageinret = -1;
     int pageoutret = -1;
+
+    /* Run test for I state change iterations, then the range test */
+    if(iterations > MAXITERATIONS){
+	if(rangetest(q, tick)){
+	    fprintf(stdout, "API Test Exiting\n");
+	    exit(EXIT_SUCCESS);
+	}
+	tick++;
+	return;
+    }
     
     /* All pages are swapped out on start */
     if(q[testProc].pages[testPage]){
@@ -94,12 +160,6 @@ void pageit(Pentry q[MAXPROCESSES]) {
 	}
     }
    
-    /* Run test for I state change iterations */
-    if(iterations > MAXITERATIONS){
-	fprintf(stdout, "API Test Exiting\n");
-	exit(EXIT_SUCCESS);
-    }
-
     tick++;
 
 } 
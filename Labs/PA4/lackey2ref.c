@@ -0,0 +1,207 @@
+/*
+ * File: lackey2ref.c
+ *
+ * Project: CSCI 3753 Programming Assignment 4
+ * Description:
+ * 	Converts memory traces from valgrind's lackey tool into a
+ *      binary reference trace for the simulator's -replay mode:
+ *          valgrind --tool=lackey --trace-mem=yes --log-file=a.out prog
+ *          lackey2ref a.ref a.out [b.out ...]
+ *          test-lru -replay a.ref -pages n
+ *      Each lackey file becomes one job, of its own kind. Every
+ *      access is one tick. The pages a job touches are numbered in
+ *      the order it first touches them, so n only has to be the
+ *      number of distinct pages, which is printed for each job.
+ *
+ * Usage:
+ *      lackey2ref [-pagebytes 4096] [-code] out.ref lackey.out...
+ *      -code keeps only instruction fetches; a lackey file of "-" is
+ *      read from standard input.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "replay.h"
+
+#define MINBUCKETS 1024
+
+/* real page number to the job's own page number */
+struct pagemap {
+    uint64_t *real;
+    long *page;
+    long nbuckets;
+    long npages;
+};
+
+static void *lackey_alloc(size_t size)
+{
+    void *p = calloc(1, size);
+
+    if (!p) {
+	perror("Error on lackey2ref Malloc");
+	exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+static long *lackey_slot(struct pagemap *m, uint64_t real)
+{
+    uint64_t h = real * 0x9e3779b97f4a7c15ULL;
+    long i = (long) (h >> 20) & (m->nbuckets - 1);
+
+    while (m->page[i] >= 0 && m->real[i] != real) {
+	i = (i + 1) & (m->nbuckets - 1);
+    }
+    m->real[i] = real;
+    return &m->page[i];
+}
+
+static void lackey_grow(struct pagemap *m)
+{
+    struct pagemap old = *m;
+    long i;
+
+    m->nbuckets = old.nbuckets ? 2 * old.nbuckets : MINBUCKETS;
+    m->real = lackey_alloc(m->nbuckets * sizeof(uint64_t));
+    m->page = lackey_alloc(m->nbuckets * sizeof(long));
+    memset(m->page, -1, m->nbuckets * sizeof(long));
+    for (i = 0; i < old.nbuckets; i++) {
+	if (old.page[i] >= 0) {
+	    *lackey_slot(m, old.real[i]) = old.page[i];
+	}
+    }
+    free(old.real);
+    free(old.page);
+}
+
+static long lackey_page(struct pagemap *m, uint64_t real)
+{
+    long *slot;
+
+    if (2 * (m->npages + 1) > m->nbuckets) {
+	lackey_grow(m);
+    }
+    slot = lackey_slot(m, real);
+    if (*slot < 0) {
+	*slot = m->npages++;
+    }
+    return *slot;
+}
+
+static int lackey_put(FILE *out, long pid, long page, long ticks)
+{
+    struct replayrec rec;
+
+    rec.pid = pid;
+    rec.kind = pid;
+    rec.page = page;
+    while (ticks > 0) {
+	rec.ticks = ticks > INT32_MAX ? INT32_MAX : ticks;
+	ticks -= rec.ticks;
+	if (fwrite(&rec, sizeof(rec), 1, out) != 1) {
+	    return -1;
+	}
+    }
+    return 0;
+}
+
+/* convert one lackey file into job pid's runs */
+static int lackey_job(FILE *in, FILE *out, long pid, long pagebytes,
+		      int codeonly)
+{
+    struct pagemap m;
+    char line[256];
+    char type;
+    unsigned long long addr;
+    long page;
+    long run = -1;
+    long ticks = 0;
+    long refs = 0;
+
+    memset(&m, 0, sizeof(m));
+    while (fgets(line, sizeof(line), in)) {
+	// "I  04016970,3", " L 7ff000438,8", also S and M; skip the rest
+	if (sscanf(line, " %c %llx,", &type, &addr) != 2
+	    || !strchr(codeonly ? "I" : "ILSM", type) || line[0] == '=') {
+	    continue;
+	}
+	page = lackey_page(&m, addr / pagebytes);
+	refs++;
+	if (page == run) {
+	    ticks++;
+	    continue;
+	}
+	if (run >= 0 && lackey_put(out, pid, run, ticks) < 0) {
+	    return -1;
+	}
+	run = page;
+	ticks = 1;
+    }
+    if (run >= 0 && lackey_put(out, pid, run, ticks) < 0) {
+	return -1;
+    }
+    fprintf(stderr, "job %ld: %ld references, %ld pages\n",
+	    pid, refs, m.npages);
+    free(m.real);
+    free(m.page);
+    return refs ? 0 : -1;
+}
+
+int main(int argc, char **argv)
+{
+    struct replayheader h;
+    long pagebytes = 4096;
+    int codeonly = 0;
+    int i = 1;
+    long pid;
+    FILE *out;
+    FILE *in;
+
+    for (; i < argc && argv[i][0] == '-' && argv[i][1]; i++) {
+	if (!strcmp(argv[i], "-pagebytes") && i + 1 < argc) {
+	    pagebytes = atol(argv[++i]);
+	} else if (!strcmp(argv[i], "-code")) {
+	    codeonly = 1;
+	} else {
+	    break;
+	}
+    }
+    if (argc - i < 2 || pagebytes < 1 || argc - i - 1 > REPLAY_MAXKIND + 1) {
+	fprintf(stderr, "usage: %s [-pagebytes 4096] [-code] out.ref"
+		" lackey.out...\n", argv[0]);
+	return EXIT_FAILURE;
+    }
+    out = fopen(argv[i], "w");
+    if (!out) {
+	perror("Error opening reference trace");
+	return EXIT_FAILURE;
+    }
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, REPLAY_MAGIC, sizeof(REPLAY_MAGIC));
+    h.version = REPLAY_VERSION;
+    h.recsize = sizeof(struct replayrec);
+    fwrite(&h, sizeof(h), 1, out);
+
+    for (i++, pid = 0; i < argc; i++, pid++) {
+	in = strcmp(argv[i], "-") ? fopen(argv[i], "r") : stdin;
+	if (!in) {
+	    perror(argv[i]);
+	    return EXIT_FAILURE;
+	}
+	if (lackey_job(in, out, pid, pagebytes, codeonly) < 0) {
+	    fprintf(stderr, "%s: no memory accesses converted\n", argv[i]);
+	    return EXIT_FAILURE;
+	}
+	if (in != stdin) {
+	    fclose(in);
+	}
+    }
+    if (fclose(out) != 0) {
+	perror("Error writing reference trace");
+	return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
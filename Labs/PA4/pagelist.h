@@ -0,0 +1,122 @@
+/*
+ * File: pagelist.h
+ *
+ * Project: CSCI 3753 Programming Assignment 4
+ * Description:
+ * 	Intrusive doubly linked lists of pages for the pagers to keep
+ *      their eviction order in. They are threaded through prev/next
+ *      arrays indexed by slot, process * maxprocpages + page, so they
+ *      allocate nothing as pages come and go. Index nslots + k is the
+ *      head of list k: next[nslots + k] is the first page on it and
+ *      prev[nslots + k] the last. A page is on one list at most, and
+ *      one on none points at itself, so every operation is O(1).
+ *      Most pagers keep one list, list 0.
+ */
+
+#ifndef PAGELIST_H
+#define PAGELIST_H
+
+#include <stdlib.h>
+
+struct pagelist {
+    int nslots;
+    int nlists;
+    int *prev;
+    int *next;
+};
+
+/* Function to make nlists empty lists over nslots pages
+ * Returns 0, or -1 if out of memory
+ */
+static inline int pagelist_init_lists(struct pagelist *l, int nslots, int nlists)
+{
+    int i;
+
+    l->nslots = nslots;
+    l->nlists = nlists;
+    l->prev = malloc((nslots + nlists) * sizeof(int));
+    l->next = malloc((nslots + nlists) * sizeof(int));
+    if (!l->prev || !l->next)
+    {
+        free(l->prev);
+        free(l->next);
+        return -1;
+    }
+    for (i = 0; i < nslots + nlists; i++)
+    {
+        l->prev[i] = l->next[i] = i; // unlinked pages point at themselves
+    }
+    return 0;
+}
+
+/* Function to make one empty list over nslots pages
+ * Returns 0, or -1 if out of memory
+ */
+static inline int pagelist_init(struct pagelist *l, int nslots)
+{
+    return pagelist_init_lists(l, nslots, 1);
+}
+
+/* Function to release a list */
+static inline void pagelist_free(struct pagelist *l)
+{
+    free(l->prev);
+    free(l->next);
+}
+
+/* Function to tell whether a page is on a list */
+static inline int pagelist_linked(const struct pagelist *l, int slot)
+{
+    return l->next[slot] != slot;
+}
+
+/* Function to take a page off its list; it must be on one */
+static inline void pagelist_unlink(struct pagelist *l, int slot)
+{
+    l->next[l->prev[slot]] = l->next[slot];
+    l->prev[l->next[slot]] = l->prev[slot];
+    l->prev[slot] = l->next[slot] = slot;
+}
+
+/* Function to put a page last on list k, moving it there if it is
+ * on a list already
+ */
+static inline void pagelist_append_to(struct pagelist *l, int k, int slot)
+{
+    int head = l->nslots + k;
+
+    if (pagelist_linked(l, slot))
+    {
+        pagelist_unlink(l, slot);
+    }
+    l->prev[slot] = l->prev[head];
+    l->next[slot] = head;
+    l->next[l->prev[head]] = slot;
+    l->prev[head] = slot;
+}
+
+/* Function to put a page last on list 0 */
+static inline void pagelist_append(struct pagelist *l, int slot)
+{
+    pagelist_append_to(l, 0, slot);
+}
+
+/* Function to find the first page on list k
+ * Returns its slot, or -1 if the list is empty
+ */
+static inline int pagelist_first_of(const struct pagelist *l, int k)
+{
+    int head = l->nslots + k;
+
+    return l->next[head] != head ? l->next[head] : -1;
+}
+
+/* Function to find the first page on list 0
+ * Returns its slot, or -1 if the list is empty
+ */
+static inline int pagelist_first(const struct pagelist *l)
+{
+    return pagelist_first_of(l, 0);
+}
+
+#endif
@@ -10,133 +10,227 @@
  * Modify Date: 2012/04/03
  * Description:
  * 	This file contains an lru pageit
- *      implmentation.
+ *      implmentation. It is a pager plugin: linked into test-lru,
+ *      or built as pager-lru.so for -pager.
  */
 
-#include <stdio.h> 
+#include <stdio.h>
 #include <stdlib.h>
 #include <limits.h>
 
 #include "simulator.h"
-
-void pageit(Pentry q[MAXPROCESSES]) { 
-    
-    /* This file contains the stub for an LRU pager */
-    /* You may need to add/remove/modify any part of this file */
-
-    /* Static vars */
-    static int initialized = 0;
-    static int tick = 1; // artificial time
-    static int timestamps[MAXPROCESSES][MAXPROCPAGES];
-
-    /* Local vars */
-    int proctmp;
-    int pagetmp;
-
-    int process_counter;
-    int page_counter;
-
-    int process_page;
-    int max = INT_MAX;
-
-    int l;
-    int l_i;
-
-
-    /* initialize static vars on first run */
-    if(!initialized){
-    for(proctmp=0; proctmp < MAXPROCESSES; proctmp++){
-        for(pagetmp=0; pagetmp < MAXPROCPAGES; pagetmp++){
-        timestamps[proctmp][pagetmp] = 0; 
-        }
+#include "pagelist.h"
+
+/* Page states as this pager sees them */
+#define PAGE_FREE     0 // not in memory
+#define PAGE_INCOMING 1 // pagein started
+#define PAGE_RESIDENT 2 // in memory
+#define PAGE_OUTGOING 3 // pageout started, frame not yet free
+
+#define SLOT(l, proc, page) ((proc) * (l)->maxpages + (page))
+
+/* Each process has an LRU list of its resident pages other than its
+ * current one: the first page is its least recently used and the last
+ * the most recent. A page is touched when the pc moves off it. As in
+ * the original scan, replacement is local: a process that faults
+ * gives up its own least recently used page, so one process's loop
+ * never pushes out another's working pages, and finding it is just
+ * the first page on its list. */
+struct lru
+{
+    const struct pagerhost *host;
+    int maxprocs;
+    int maxpages;
+    long pagesize;
+    long physical;
+    int reserve;     // frames kept free for faults
+    int nslots;
+    struct pagelist lru;  // one list per process
+    char *state;     // maxprocs x maxpages
+    int *current;    // page under each process's pc, -1 if none
+    int *pending;    // page each process is blocked on, -1 if none
+    int npending;
+    int noutgoing;   // frames already on their way to being free
+    int nused;       // frames incoming, resident or outgoing
+};
+
+static void *lru_init(const struct pagerhost *host)
+{
+    struct lru *l;
+    int i;
+
+    l = calloc(1, sizeof(struct lru));
+    if(!l){
+        perror("Error on LRU Malloc");
+        exit(EXIT_FAILURE);
     }
-    initialized = 1;
+    l->host = host;
+    l->maxprocs = host->scale.maxprocesses;
+    l->maxpages = host->scale.maxprocpages;
+    l->pagesize = host->scale.pagesize;
+    l->physical = host->scale.physicalpages;
+    l->reserve = l->maxprocs / 2;
+    l->nslots = l->maxprocs * l->maxpages;
+    l->state = calloc(l->nslots, sizeof(char));
+    l->current = malloc(l->maxprocs * sizeof(int));
+    l->pending = malloc(l->maxprocs * sizeof(int));
+    if(pagelist_init_lists(&l->lru, l->nslots, l->maxprocs) || !l->state || !l->current
+       || !l->pending){
+        perror("Error on LRU Malloc");
+        exit(EXIT_FAILURE);
     }
-    
-    /* TODO: Implement LRU Paging */
-
-    //For all available processes
-    for (process_counter = 0; process_counter < MAXPROCESSES; process_counter++)
+    for(i = 0; i < l->maxprocs; i++)
     {
-        //If process is active:
-        if (q[process_counter].active)
+        l->current[i] = l->pending[i] = -1;
+    }
+    return l;
+}
+
+static void lru_fini(void *state)
+{
+    struct lru *l = state;
+
+    pagelist_free(&l->lru);
+    free(l->state);
+    free(l->current);
+    free(l->pending);
+    free(l);
+}
+
+/* start page-ins for blocked processes, then have those still
+ * waiting each give up their least recently used page, while the
+ * frames free or on their way out don't cover them plus a small
+ * reserve, so most faults find a frame ready instead of paying for a
+ * pageout first */
+static void lru_service(struct lru *l)
+{
+    int proc;
+    int victim;
+
+    for (proc = 0; proc < l->maxprocs && l->npending > 0; proc++)
+    {
+        if (l->pending[proc] >= 0
+            && l->host->pagein(proc, l->pending[proc]))
         {
-            //Find the page of that active process
-            process_page = q[process_counter].pc / PAGESIZE;
-
-            //If page HAS not been swapped out:
-            if (!q[process_counter].pages[process_page])
-            {
-                //If page cannot be swapped in (must evict page)
-                if (!pagein(process_counter, process_page))
-                {
-                    l = max;
-                    l_i = 0;
-
-                    //Find a page to evict (LRU)
-                    for (page_counter = 0; page_counter < MAXPROCPAGES; page_counter++)
-                    {
-                        if (process_page != page_counter)
-                        {
-                            if (timestamps[process_counter][page_counter] > 0)
-                            {
-                                if (timestamps[process_counter][page_counter] < l)
-                                {
-                                    l = timestamps[process_counter][page_counter];
-                                    l_i = page_counter;
-                                }
-                            }
-                        }
-                    }
-                    //If pageout is able to swap out that page:
-                    if (pageout(process_counter, l_i))
-                    {
-                        //Reset timestamp to zero
-                        timestamps[process_counter][l_i] = tick;
-                    }                  
-                }
-            }
-
-            else
-            {
-                //Update timestamp to tick
-                timestamps[process_counter][process_page] = tick;
-            }
+            l->state[SLOT(l, proc, l->pending[proc])] = PAGE_INCOMING;
+            l->pending[proc] = -1;
+            l->npending--;
+            l->nused++;
         }
     }
 
+    for (proc = 0; proc < l->maxprocs
+             && l->physical - l->nused + l->noutgoing < l->npending + l->reserve; proc++)
+    {
+        if (l->pending[proc] < 0 || (victim = pagelist_first_of(&l->lru, proc)) < 0)
+        {
+            continue;
+        }
+        pagelist_unlink(&l->lru, victim);
+        if (l->host->pageout(victim / l->maxpages, victim % l->maxpages))
+        {
+            l->state[victim] = PAGE_OUTGOING;
+            l->noutgoing++;
+        }
+    }
+}
 
-    /* advance time for next pageit iteration */
-    tick++;
-} 
-
-
-
-/*
-
-Loop all available processes
-
-    If page is active
+/* a process left its slot; the simulator freed all of its frames */
+static void lru_unload(struct lru *l, int proc)
+{
+    int page;
+    int slot;
 
-        Find page being requested of that active process
+    for (page = 0; page < l->maxpages; page++)
+    {
+        slot = SLOT(l, proc, page);
+        if (l->state[slot] == PAGE_OUTGOING)
+        {
+            l->noutgoing--;
+        }
+        if (l->state[slot] != PAGE_FREE)
+        {
+            l->nused--;
+        }
+        if (pagelist_linked(&l->lru, slot))
+        {
+            pagelist_unlink(&l->lru, slot);
+        }
+        l->state[slot] = PAGE_FREE;
+    }
+    if (l->pending[proc] >= 0)
+    {
+        l->npending--;
+    }
+    l->pending[proc] = -1;
+    l->current[proc] = -1;
+}
 
-        Is page swapped in?
+static void lru_events(void *state, Pevent events[], int nevents, long clock)
+{
+    struct lru *l = state;
+    Pevent *e;
+    int slot;
+    int i;
 
-            YES: Select another process to work on
+    (void) clock;
 
-            NO: Call pagein()
+    for (i = 0; i < nevents; i++)
+    {
+        e = &events[i];
+        slot = SLOT(l, e->process, e->page);
+        switch (e->type)
+        {
+        case PAGER_LOAD:
+            l->current[e->process] = e->pc / l->pagesize;
+            break;
 
-                SUCCEED: Select another process to work on
+        case PAGER_UNLOAD:
+            lru_unload(l, e->process);
+            break;
 
-                FAIL: SELECT PAGE TO EVICT
+        case PAGER_FAULT:
+            if (l->pending[e->process] < 0)
+            {
+                l->npending++;
+            }
+            l->pending[e->process] = e->page;
+            break;
 
-                    Call pageout()
-    
+        case PAGER_PCPAGE:
+            //The page the pc left is now the most recently used
+            if (l->state[SLOT(l, e->process, e->prevpage)] == PAGE_RESIDENT)
+            {
+                pagelist_append_to(&l->lru, e->process,
+                                   SLOT(l, e->process, e->prevpage));
+            }
+            //The page the pc is on can't be evicted while it's there
+            if (pagelist_linked(&l->lru, slot))
+            {
+                pagelist_unlink(&l->lru, slot);
+            }
+            l->current[e->process] = e->page;
+            break;
 
-Each time a page does not need to be evicted, increment timestamp for that page each iteration.
+        case PAGER_PAGEIN_DONE:
+            l->state[slot] = PAGE_RESIDENT;
+            if (l->current[e->process] != e->page)
+            {
+                pagelist_append_to(&l->lru, e->process, slot);
+            }
+            break;
 
-If a page must be evicted:
+        case PAGER_PAGEOUT_DONE:
+            l->state[slot] = PAGE_FREE;
+            l->noutgoing--;
+            l->nused--;
+            break;
+        }
+    }
 
-    L is infinity
+    lru_service(l);
+}
 
-    Loop finds page with lowest timestamp, and calls pageout() on that page
+const struct pagerops pager_plugin = {
+    PAGER_ABI, "lru", lru_init, lru_events, NULL, lru_fini
+};
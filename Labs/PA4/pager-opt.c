@@ -0,0 +1,522 @@
+/*
+ * File: pager-opt.c
+ *
+ * Project: CSCI 3753 Programming Assignment 4
+ * Description:
+ * 	This file contains an offline optimal (Belady) pageit
+ *      implementation. It is a pager plugin: linked into test-opt,
+ *      or built as pager-opt.so for -pager. It needs the reference
+ *      trace of the run:
+ *          test-opt -seed s -reftrace f -pagerarg f
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+
+#include "simulator.h"
+
+/* Page states as this pager sees them */
+#define PAGE_FREE     0 // not in memory
+#define PAGE_INCOMING 1 // pagein started
+#define PAGE_RESIDENT 2 // in memory
+#define PAGE_OUTGOING 3 // pageout started, frame not yet free
+
+#define MAXAHEAD 4      // runs past the current one to prefetch
+
+#define SLOT(o, proc, page) ((proc) * (o)->maxpages + (page))
+#define NEVER LONG_MAX
+#define UNKNOWN (-2)
+
+/* One job's reference trace: the pages its pc visits, as runs of
+ * ticks on one page. start is the job's compute time when each run
+ * begins and nextrun the next run on the same page, so the distance
+ * to a page's next use is one subtraction. */
+struct job {
+    long kind;
+    long nruns;
+    int *page;
+    long *start;
+    long *nextrun;
+    long *firstrun;     // maxpages: first run on each page
+    long run;           // run it was on when last unloaded
+};
+
+/* a demand for a frame: bring page in for proc, needed in dist ticks */
+struct demand {
+    int proc;
+    int page;
+    long dist;
+};
+
+/* Belady's MIN with perfect prefetch: the whole future of every job is
+ * known, so each process has the next pages it will touch paged in
+ * ahead of time, and a frame is only ever taken from the page whose
+ * next use is furthest away, and only if that is further away than the
+ * page it is wanted for. Each PAGER_LOAD names its job by pid, and a
+ * job suspended by -loadctl picks up at the run it was on. With more than one process and transfers that
+ * take time this is not a proof of optimality, but no online pager has
+ * more to go on, so its ratio is the floor to compare the others to. */
+struct opt
+{
+    const struct pagerhost *host;
+    int maxprocs;
+    int maxpages;
+    long physical;
+    long ahead;      // how far ahead prefetches look
+    long horizon;    // pages needed sooner are never evicted early
+    int reserve;     // frames kept free for demands
+    struct job *jobs;
+    long njobs;
+    char *state;     // maxprocs x maxpages
+    long *nextidx;   // maxprocs x maxpages: next run on each page
+    struct job **running; // job in each slot, NULL if none
+    long *run;       // run each slot is on
+    int nused;       // frames incoming, resident or outgoing
+    int noutgoing;   // frames on their way to being free
+    struct demand *demands;
+    int *furthest;   // each process's resident page used furthest
+                     // ahead, -1 if none, UNKNOWN until looked for
+};
+
+static void opt_fail(const char *why)
+{
+    fprintf(stderr, "pager-opt: %s\n", why);
+    exit(EXIT_FAILURE);
+}
+
+static struct job *opt_job(struct opt *o, long pid)
+{
+    long i;
+
+    if (pid >= o->njobs)
+    {
+        o->jobs = realloc(o->jobs, (pid + 1) * sizeof(struct job));
+        if(!o->jobs){
+            perror("Error on opt Malloc");
+            exit(EXIT_FAILURE);
+        }
+        for (i = o->njobs; i <= pid; i++)
+        {
+            o->jobs[i].kind = -1;
+            o->jobs[i].nruns = 0;
+            o->jobs[i].page = NULL;
+            o->jobs[i].start = NULL;
+            o->jobs[i].run = 0;
+        }
+        o->njobs = pid + 1;
+    }
+    return &o->jobs[pid];
+}
+
+/* read the trace written by the simulator's -reftrace */
+static void opt_load(struct opt *o, const char *path)
+{
+    FILE *fp;
+    char line[256];
+    long pid, kind, page, ticks;
+    long i, j;
+    struct job *jb;
+
+    if (!path)
+    {
+        opt_fail("needs the reference trace: -reftrace f -pagerarg f");
+    }
+    fp = fopen(path, "r");
+    if (!fp)
+    {
+        perror("Error opening reference trace");
+        exit(EXIT_FAILURE);
+    }
+    while (fgets(line, sizeof(line), fp))
+    {
+        if (line[0] == '#')
+        {
+            continue;
+        }
+        if (sscanf(line, "%ld %ld %ld %ld", &pid, &kind, &page, &ticks) != 4
+            || pid < 0 || page < 0 || page >= o->maxpages)
+        {
+            opt_fail("bad line in reference trace");
+        }
+        jb = opt_job(o, pid);
+        jb->kind = kind;
+        jb->page = realloc(jb->page, (jb->nruns + 1) * sizeof(int));
+        jb->start = realloc(jb->start, (jb->nruns + 2) * sizeof(long));
+        if(!jb->page || !jb->start){
+            perror("Error on opt Malloc");
+            exit(EXIT_FAILURE);
+        }
+        if (jb->nruns == 0)
+        {
+            jb->start[0] = 0;
+        }
+        jb->page[jb->nruns] = page;
+        jb->start[jb->nruns + 1] = jb->start[jb->nruns] + ticks;
+        jb->nruns++;
+    }
+    fclose(fp);
+
+    for (i = 0; i < o->njobs; i++)
+    {
+        jb = &o->jobs[i];
+        jb->nextrun = malloc((jb->nruns + 1) * sizeof(long));
+        jb->firstrun = malloc(o->maxpages * sizeof(long));
+        if(!jb->nextrun || !jb->firstrun){
+            perror("Error on opt Malloc");
+            exit(EXIT_FAILURE);
+        }
+        for (page = 0; page < o->maxpages; page++)
+        {
+            jb->firstrun[page] = jb->nruns;
+        }
+        for (j = jb->nruns - 1; j >= 0; j--)
+        {
+            jb->nextrun[j] = jb->firstrun[jb->page[j]];
+            jb->firstrun[jb->page[j]] = j;
+        }
+    }
+}
+
+static void *opt_init(const struct pagerhost *host)
+{
+    struct opt *o;
+
+    o = calloc(1, sizeof(struct opt));
+    if(!o){
+        perror("Error on opt Malloc");
+        exit(EXIT_FAILURE);
+    }
+    o->host = host;
+    o->maxprocs = host->scale.maxprocesses;
+    o->maxpages = host->scale.maxprocpages;
+    o->physical = host->scale.physicalpages;
+    o->ahead = host->scale.pagesize + host->scale.pagewait;
+    o->horizon = 4 * host->scale.pagesize;
+    o->reserve = o->maxprocs / 2;
+    o->state = calloc(o->maxprocs * o->maxpages, sizeof(char));
+    o->nextidx = malloc(o->maxprocs * o->maxpages * sizeof(long));
+    o->running = calloc(o->maxprocs, sizeof(struct job *));
+    o->run = calloc(o->maxprocs, sizeof(long));
+    o->demands = malloc(o->maxprocs * (MAXAHEAD + 1) * sizeof(struct demand));
+    o->furthest = malloc(o->maxprocs * sizeof(int));
+    if(!o->state || !o->nextidx || !o->running || !o->run || !o->demands
+       || !o->furthest){
+        perror("Error on opt Malloc");
+        exit(EXIT_FAILURE);
+    }
+    opt_load(o, host->arg);
+    return o;
+}
+
+static void opt_fini(void *state)
+{
+    struct opt *o = state;
+    long i;
+
+    for (i = 0; i < o->njobs; i++)
+    {
+        free(o->jobs[i].page);
+        free(o->jobs[i].start);
+        free(o->jobs[i].nextrun);
+        free(o->jobs[i].firstrun);
+    }
+    free(o->jobs);
+    free(o->state);
+    free(o->nextidx);
+    free(o->running);
+    free(o->run);
+    free(o->demands);
+    free(o->furthest);
+    free(o);
+}
+
+/* ticks of proc's own time until it next uses page */
+static long opt_distance(struct opt *o, int proc, int page)
+{
+    struct job *jb = o->running[proc];
+    long next = o->nextidx[SLOT(o, proc, page)];
+
+    if (page == jb->page[o->run[proc]])
+    {
+        return 0;
+    }
+    if (next >= jb->nruns)
+    {
+        return NEVER;
+    }
+    return jb->start[next] - jb->start[o->run[proc]];
+}
+
+static void opt_evict(struct opt *o, int slot)
+{
+    if (o->host->pageout(slot / o->maxpages, slot % o->maxpages))
+    {
+        o->state[slot] = PAGE_OUTGOING;
+        o->noutgoing++;
+        o->furthest[slot / o->maxpages] = UNKNOWN;
+    }
+}
+
+static int opt_bydistance(const void *a, const void *b)
+{
+    long da = ((const struct demand *) a)->dist;
+    long db = ((const struct demand *) b)->dist;
+
+    return (da > db) - (da < db);
+}
+
+/* the resident page whose next use is furthest away. Every page of a
+ * process moves nearer at the same rate while it runs, so which of
+ * its pages is furthest only changes with its own events; that page
+ * is remembered per process and only those are compared */
+static int opt_victim(struct opt *o, long *dist)
+{
+    int proc;
+    int page;
+    int best = -1;
+    long d;
+
+    *dist = -1;
+    for (proc = 0; proc < o->maxprocs; proc++)
+    {
+        if (!o->running[proc])
+        {
+            continue;
+        }
+        if (o->furthest[proc] == UNKNOWN)
+        {
+            o->furthest[proc] = -1;
+            d = -1;
+            for (page = 0; page < o->maxpages; page++)
+            {
+                if (o->state[SLOT(o, proc, page)] == PAGE_RESIDENT
+                    && opt_distance(o, proc, page) > d)
+                {
+                    d = opt_distance(o, proc, page);
+                    o->furthest[proc] = page;
+                }
+            }
+        }
+        if (o->furthest[proc] < 0)
+        {
+            continue;
+        }
+        d = opt_distance(o, proc, o->furthest[proc]);
+        if (d > *dist)
+        {
+            *dist = d;
+            best = SLOT(o, proc, o->furthest[proc]);
+        }
+    }
+    return best;
+}
+
+/* every process wants its current page and the pages of the runs
+ * starting within ahead ticks; serve the soonest needed first */
+static void opt_service(struct opt *o)
+{
+    int ndemands = 0;
+    int first;
+    int proc;
+    int claimed = 0;
+    int victim;
+    long vdist;
+    long j;
+    int i;
+    struct job *jb;
+    struct demand *d;
+
+    for (proc = 0; proc < o->maxprocs; proc++)
+    {
+        jb = o->running[proc];
+        if (!jb)
+        {
+            continue;
+        }
+        first = ndemands;
+        for (j = o->run[proc]; j < jb->nruns && j <= o->run[proc] + MAXAHEAD; j++)
+        {
+            if (jb->start[j] - jb->start[o->run[proc]] > o->ahead)
+            {
+                break;
+            }
+            if (o->state[SLOT(o, proc, jb->page[j])] != PAGE_FREE
+                && o->state[SLOT(o, proc, jb->page[j])] != PAGE_OUTGOING)
+            {
+                continue;
+            }
+            for (i = first; i < ndemands; i++)
+            {
+                if (o->demands[i].page == jb->page[j])
+                {
+                    break;
+                }
+            }
+            if (i == ndemands)
+            {
+                d = &o->demands[ndemands++];
+                d->proc = proc;
+                d->page = jb->page[j];
+                d->dist = jb->start[j] - jb->start[o->run[proc]];
+            }
+        }
+    }
+    qsort(o->demands, ndemands, sizeof(struct demand), opt_bydistance);
+
+    for (i = 0; i < ndemands; i++)
+    {
+        d = &o->demands[i];
+        if (o->state[SLOT(o, d->proc, d->page)] == PAGE_FREE && o->nused < o->physical)
+        {
+            if (o->host->pagein(d->proc, d->page))
+            {
+                o->state[SLOT(o, d->proc, d->page)] = PAGE_INCOMING;
+                o->nused++;
+            }
+            continue;
+        }
+        if (claimed < o->noutgoing)
+        {
+            claimed++; // a frame already on its way out covers this one
+            continue;
+        }
+        victim = opt_victim(o, &vdist);
+        if (victim < 0 || vdist <= d->dist)
+        {
+            break; // nothing resident is needed later than this
+        }
+        opt_evict(o, victim);
+        claimed++;
+    }
+
+    //Keep a few frames free for the next demands, from pages not needed soon
+    while (o->physical - o->nused + o->noutgoing - claimed < o->reserve)
+    {
+        victim = opt_victim(o, &vdist);
+        if (victim < 0 || vdist <= o->horizon)
+        {
+            break;
+        }
+        opt_evict(o, victim);
+    }
+}
+
+static void opt_unload(struct opt *o, int proc)
+{
+    int page;
+    int slot;
+
+    for (page = 0; page < o->maxpages; page++)
+    {
+        slot = SLOT(o, proc, page);
+        if (o->state[slot] == PAGE_OUTGOING)
+        {
+            o->noutgoing--;
+        }
+        if (o->state[slot] != PAGE_FREE)
+        {
+            o->nused--;
+        }
+        o->state[slot] = PAGE_FREE;
+    }
+    if (o->running[proc])
+    {
+        o->running[proc]->run = o->run[proc]; // in case it is resumed
+    }
+    o->running[proc] = NULL;
+}
+
+/* job pid goes into slot proc, at the run it left off on if it was
+ * suspended; each page is next used at its first run from there */
+static void opt_load_job(struct opt *o, int proc, long pid, long kind)
+{
+    struct job *jb;
+    int page;
+    long next;
+
+    if (pid < 0 || pid >= o->njobs || o->jobs[pid].kind != kind)
+    {
+        opt_fail("reference trace does not match this run");
+    }
+    jb = &o->jobs[pid];
+    o->running[proc] = jb;
+    o->run[proc] = jb->run;
+    o->furthest[proc] = UNKNOWN;
+    for (page = 0; page < o->maxpages; page++)
+    {
+        next = jb->firstrun[page];
+        while (next < jb->run)
+        {
+            next = jb->nextrun[next];
+        }
+        o->nextidx[SLOT(o, proc, page)] = next;
+    }
+}
+
+/* the pc moved on: the page it left is next used at its next run */
+static void opt_advance(struct opt *o, int proc, int page)
+{
+    struct job *jb = o->running[proc];
+    long r = o->run[proc];
+
+    o->nextidx[SLOT(o, proc, jb->page[r])] = jb->nextrun[r];
+    if (r + 1 >= jb->nruns || jb->page[r + 1] != page)
+    {
+        opt_fail("reference trace does not match this run");
+    }
+    o->run[proc] = r + 1;
+    o->nextidx[SLOT(o, proc, page)] = jb->nextrun[r + 1];
+    o->furthest[proc] = UNKNOWN;
+}
+
+static void opt_events(void *state, Pevent events[], int nevents, long clock)
+{
+    struct opt *o = state;
+    Pevent *e;
+    int slot;
+    int i;
+
+    (void) clock;
+
+    for (i = 0; i < nevents; i++)
+    {
+        e = &events[i];
+        slot = SLOT(o, e->process, e->page);
+        switch (e->type)
+        {
+        case PAGER_LOAD:
+            opt_load_job(o, e->process, e->pid, e->kind);
+            break;
+
+        case PAGER_UNLOAD:
+            opt_unload(o, e->process);
+            break;
+
+        case PAGER_FAULT:
+            //The current page is always demanded; served below
+            break;
+
+        case PAGER_PCPAGE:
+            opt_advance(o, e->process, e->page);
+            break;
+
+        case PAGER_PAGEIN_DONE:
+            o->state[slot] = PAGE_RESIDENT;
+            o->furthest[e->process] = UNKNOWN;
+            break;
+
+        case PAGER_PAGEOUT_DONE:
+            o->state[slot] = PAGE_FREE;
+            o->noutgoing--;
+            o->nused--;
+            break;
+        }
+    }
+
+    opt_service(o);
+}
+
+const struct pagerops pager_plugin = {
+    PAGER_ABI, "opt", opt_init, opt_events, NULL, opt_fini
+};
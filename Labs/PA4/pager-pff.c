@@ -0,0 +1,356 @@
+/*
+ * File: pager-pff.c
+ *
+ * Project: CSCI 3753 Programming Assignment 4
+ * Description:
+ * 	This file contains a page-fault-frequency pageit
+ *      implementation. It is a pager plugin: linked into test-pff,
+ *      or built as pager-pff.so for -pager.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "simulator.h"
+#include "pagelist.h"
+
+/* Page states as this pager sees them */
+#define PAGE_FREE     0 // not in memory
+#define PAGE_INCOMING 1 // pagein started
+#define PAGE_RESIDENT 2 // in memory
+#define PAGE_OUTGOING 3 // pageout started, frame not yet free
+
+#define SLOT(f, proc, page) ((proc) * (f)->maxpages + (page))
+
+/* Page fault frequency: each process's frame allotment follows how
+ * often it faults. A fault that comes sooner than interval after the
+ * process's last one means it needs more frames, so the allotment
+ * grows by the new page. A fault after a longer calm means its
+ * locality has moved on, so every page it has not touched since the
+ * last fault is paged out first and the allotment shrinks to what it
+ * actually uses plus the new page.
+ *
+ * A process that faults while it already holds its allotment pages
+ * out its own least recently used page for the new one. If the
+ * allotments together exceed the frames outside the reserve, each
+ * process gets a share of those in proportion to its allotment.
+ *
+ * When no frame is free, the least recently used page of any process
+ * is taken. Resident non-current pages sit on one list in the order
+ * their pcs left them, so that is the first page on the list. */
+struct pff
+{
+    const struct pagerhost *host;
+    int maxprocs;
+    int maxpages;
+    long pagesize;
+    long physical;
+    long interval;   // ticks between faults that count as calm
+    int reserve;     // frames kept free for faults
+    int nslots;
+    struct pagelist lru;
+    long *lastuse;   // when the pc last left each page
+    char *state;     // maxprocs x maxpages
+    int *current;    // page under each process's pc, -1 if none
+    int *pending;    // page each process is blocked on, -1 if none
+    long *lastfault; // when each process last faulted
+    int *budget;     // frames each process holds
+    int *outgoing;   // of those, frames on their way to being free
+    int *allot;      // frames each process may hold
+    long nallot;     // allotments of every process together
+    int npending;
+    int nused;       // frames incoming, resident or outgoing
+    int noutgoing;   // frames on their way to being free
+};
+
+static void *pff_init(const struct pagerhost *host)
+{
+    struct pff *f;
+    int i;
+
+    f = calloc(1, sizeof(struct pff));
+    if(!f){
+        perror("Error on PFF Malloc");
+        exit(EXIT_FAILURE);
+    }
+    f->host = host;
+    f->maxprocs = host->scale.maxprocesses;
+    f->maxpages = host->scale.maxprocpages;
+    f->pagesize = host->scale.pagesize;
+    f->physical = host->scale.physicalpages;
+    f->interval = 2 * f->pagesize;
+    f->reserve = f->maxprocs / 2;
+    f->nslots = f->maxprocs * f->maxpages;
+    f->lastuse = calloc(f->nslots, sizeof(long));
+    f->state = calloc(f->nslots, sizeof(char));
+    f->current = malloc(f->maxprocs * sizeof(int));
+    f->pending = malloc(f->maxprocs * sizeof(int));
+    f->lastfault = calloc(f->maxprocs, sizeof(long));
+    f->budget = calloc(f->maxprocs, sizeof(int));
+    f->outgoing = calloc(f->maxprocs, sizeof(int));
+    f->allot = calloc(f->maxprocs, sizeof(int));
+    if(pagelist_init(&f->lru, f->nslots) || !f->lastuse || !f->state
+       || !f->current || !f->pending || !f->lastfault || !f->budget
+       || !f->outgoing || !f->allot){
+        perror("Error on PFF Malloc");
+        exit(EXIT_FAILURE);
+    }
+    for(i = 0; i < f->maxprocs; i++)
+    {
+        f->current[i] = f->pending[i] = -1;
+    }
+    return f;
+}
+
+static void pff_fini(void *state)
+{
+    struct pff *f = state;
+
+    pagelist_free(&f->lru);
+    free(f->lastuse);
+    free(f->state);
+    free(f->current);
+    free(f->pending);
+    free(f->lastfault);
+    free(f->budget);
+    free(f->outgoing);
+    free(f->allot);
+    free(f);
+}
+
+/* the pc left a page at clock */
+static void pff_touch(struct pff *f, int slot, long clock)
+{
+    f->lastuse[slot] = clock;
+    pagelist_append(&f->lru, slot);
+}
+
+static void pff_evict(struct pff *f, int slot)
+{
+    pagelist_unlink(&f->lru, slot);
+    if (f->host->pageout(slot / f->maxpages, slot % f->maxpages))
+    {
+        f->state[slot] = PAGE_OUTGOING;
+        f->outgoing[slot / f->maxpages]++;
+        f->noutgoing++;
+    }
+}
+
+static void pff_allot(struct pff *f, int proc, int frames)
+{
+    f->nallot += frames - f->allot[proc];
+    f->allot[proc] = frames;
+}
+
+/* frames proc may hold: its allotment while every allotment fits,
+ * else its share of the frames outside the reserve */
+static int pff_quota(struct pff *f, int proc)
+{
+    long avail = f->physical - f->reserve;
+    long share;
+
+    if (f->nallot <= avail)
+    {
+        return f->allot[proc];
+    }
+    share = avail * f->allot[proc] / f->nallot;
+    return share > 1 ? share : 1;
+}
+
+/* proc's least recently used page, -1 if it has none listed */
+static int pff_oldest(struct pff *f, int proc)
+{
+    int page;
+    int slot;
+    int best = -1;
+
+    for (page = 0; page < f->maxpages; page++)
+    {
+        slot = SLOT(f, proc, page);
+        if (pagelist_linked(&f->lru, slot)
+            && (best < 0 || f->lastuse[slot] < f->lastuse[best]))
+        {
+            best = slot;
+        }
+    }
+    return best;
+}
+
+/* a fault after a calm spell: drop what proc hasn't used since */
+static void pff_shrink(struct pff *f, int proc)
+{
+    int page;
+    int slot;
+
+    for (page = 0; page < f->maxpages; page++)
+    {
+        slot = SLOT(f, proc, page);
+        if (pagelist_linked(&f->lru, slot)
+            && f->lastuse[slot] < f->lastfault[proc])
+        {
+            pff_evict(f, slot);
+        }
+    }
+}
+
+static void pff_fault(struct pff *f, int proc, int page, long clock)
+{
+    int held;
+
+    if (clock - f->lastfault[proc] > f->interval)
+    {
+        pff_shrink(f, proc);
+        pff_allot(f, proc, f->budget[proc] - f->outgoing[proc] + 1);
+    }
+    else
+    {
+        held = f->budget[proc] - f->outgoing[proc];
+        pff_allot(f, proc, (held > f->allot[proc] ? held : f->allot[proc]) + 1);
+    }
+    f->lastfault[proc] = clock;
+    if (f->pending[proc] < 0)
+    {
+        f->npending++;
+    }
+    f->pending[proc] = page;
+}
+
+/* start page-ins for blocked processes; one holding its allotment
+ * pages out its own least recently used page instead, and faults
+ * again into the frame once it is on its way out. Then free enough
+ * frames for the faults still waiting */
+static void pff_service(struct pff *f)
+{
+    int proc;
+    int victim;
+
+    for (proc = 0; proc < f->maxprocs && f->npending > 0; proc++)
+    {
+        if (f->pending[proc] < 0 || f->nused == f->physical)
+        {
+            continue;
+        }
+        if (f->budget[proc] - f->outgoing[proc] >= pff_quota(f, proc))
+        {
+            victim = pff_oldest(f, proc);
+            if (victim >= 0)
+            {
+                pff_evict(f, victim);
+                continue;
+            }
+            if (f->outgoing[proc] > 0)
+            {
+                continue; // its own frame is on the way
+            }
+        }
+        if (f->host->pagein(proc, f->pending[proc]))
+        {
+            f->state[SLOT(f, proc, f->pending[proc])] = PAGE_INCOMING;
+            f->pending[proc] = -1;
+            f->npending--;
+            f->budget[proc]++;
+            f->nused++;
+        }
+    }
+
+    while (f->physical - f->nused + f->noutgoing < f->npending + f->reserve
+           && (victim = pagelist_first(&f->lru)) >= 0)
+    {
+        pff_evict(f, victim);
+    }
+}
+
+/* a process left its slot; the simulator freed all of its frames */
+static void pff_unload(struct pff *f, int proc)
+{
+    int page;
+    int slot;
+
+    for (page = 0; page < f->maxpages; page++)
+    {
+        slot = SLOT(f, proc, page);
+        if (f->state[slot] == PAGE_OUTGOING)
+        {
+            f->noutgoing--;
+        }
+        if (pagelist_linked(&f->lru, slot))
+        {
+            pagelist_unlink(&f->lru, slot);
+        }
+        f->state[slot] = PAGE_FREE;
+    }
+    if (f->pending[proc] >= 0)
+    {
+        f->npending--;
+    }
+    f->nused -= f->budget[proc];
+    f->budget[proc] = 0;
+    f->outgoing[proc] = 0;
+    pff_allot(f, proc, 0);
+    f->pending[proc] = -1;
+    f->current[proc] = -1;
+}
+
+static void pff_events(void *state, Pevent events[], int nevents, long clock)
+{
+    struct pff *f = state;
+    Pevent *e;
+    int slot;
+    int i;
+
+    for (i = 0; i < nevents; i++)
+    {
+        e = &events[i];
+        slot = SLOT(f, e->process, e->page);
+        switch (e->type)
+        {
+        case PAGER_LOAD:
+            f->current[e->process] = e->pc / f->pagesize;
+            f->lastfault[e->process] = clock;
+            pff_allot(f, e->process, 1);
+            break;
+
+        case PAGER_UNLOAD:
+            pff_unload(f, e->process);
+            break;
+
+        case PAGER_FAULT:
+            pff_fault(f, e->process, e->page, clock);
+            break;
+
+        case PAGER_PCPAGE:
+            if (f->state[SLOT(f, e->process, e->prevpage)] == PAGE_RESIDENT)
+            {
+                pff_touch(f, SLOT(f, e->process, e->prevpage), clock);
+            }
+            if (pagelist_linked(&f->lru, slot))
+            {
+                pagelist_unlink(&f->lru, slot);
+            }
+            f->current[e->process] = e->page;
+            break;
+
+        case PAGER_PAGEIN_DONE:
+            f->state[slot] = PAGE_RESIDENT;
+            if (f->current[e->process] != e->page)
+            {
+                pff_touch(f, slot, clock);
+            }
+            break;
+
+        case PAGER_PAGEOUT_DONE:
+            f->state[slot] = PAGE_FREE;
+            f->budget[e->process]--;
+            f->outgoing[e->process]--;
+            f->nused--;
+            f->noutgoing--;
+            break;
+        }
+    }
+
+    pff_service(f);
+}
+
+const struct pagerops pager_plugin = {
+    PAGER_ABI, "pff", pff_init, pff_events, NULL, pff_fini
+};
@@ -10,102 +10,416 @@
  * Modify Date: 2012/04/03
  * Description:
  * 	This file contains a predictive pageit
- *      implmentation.
+ *      implmentation. It is a pager plugin: linked into test-predict,
+ *      or built as pager-predict.so for -pager.
  */
 
-#include <stdio.h> 
+#include <stdio.h>
 #include <stdlib.h>
-#include <limits.h>
 
 #include "simulator.h"
+#include "pagelist.h"
 
-void pageit(Pentry q[MAXPROCESSES]) { 
-    
+/* Page states as this pager sees them */
+#define PAGE_FREE     0 // not in memory
+#define PAGE_INCOMING 1 // pagein started
+#define PAGE_RESIDENT 2 // in memory
+#define PAGE_OUTGOING 3 // pageout started, frame not yet free
 
-    /* You may need to add/remove/modify any part of this file */
+#define MAXWANT 4       // current page plus up to 3 predicted successors
+#define MINSHARE 8      // predict successors seen at least 1/MINSHARE of the time
+#define MINSEEN 4       // transitions out of a page before trusting them
 
-    /* Static vars */
-    static int initialized = 0;
-    static int tick = 1; // artificial time
-    static int timestamps[MAXPROCESSES][MAXPROCPAGES];
+#define SLOT(p, proc, page) ((proc) * (p)->maxpages + (page))
+#define TRANS(p, kind, from, to) \
+    (p)->trans[(kind)][(from) * (p)->maxpages + (to)]
 
-    /* Local vars */
-    int proctmp;
-    int pagetmp;
+/* Markov model: for every program kind, how often the pc moved from
+ * one page to another. Every process running that kind teaches it,
+ * so after a few runs the loops and branches of each program are
+ * known and a page's likely successors are paged in while the
+ * process is still on it. A page lasts at least pagesize ticks, so
+ * when that is longer than pagewait a correct guess never blocks;
+ * when it isn't, the likeliest path is followed as many pages further
+ * as a pagein takes to cover.
+ *
+ * Resident pages no process wants soon sit on a list, least recently
+ * used first. Wanted pages are kept off it, so its first page is
+ * always the victim and eviction is O(1). */
+struct predict
+{
+    const struct pagerhost *host;
+    int maxprocs;
+    int maxpages;
+    long pagesize;
+    long physical;
+    int reserve;     // frames kept free for faults
+    int depth;       // pages ahead a pagein started now must look
+    int maxwant;     // MAXWANT plus the pages past the first successor
+    int **trans;     // per kind, maxpages x maxpages counts
+    int *seen;       // per kind and page, transitions out of it
+    long nkinds;
+    int nslots;
+    struct pagelist lru;
+    char *state;     // maxprocs x maxpages
+    int *wanted;     // processes that want each page (0 or 1)
+    int *want;       // maxprocs x maxwant pages, current first
+    int *nwant;
+    long *kinds;     // program each process runs
+    int nused;       // frames incoming, resident or outgoing
+    int noutgoing;   // frames on their way to being free
+};
+
+static void *predict_init(const struct pagerhost *host)
+{
+    struct predict *p;
+
+    p = calloc(1, sizeof(struct predict));
+    if(!p){
+        perror("Error on predict Malloc");
+        exit(EXIT_FAILURE);
+    }
+    p->host = host;
+    p->maxprocs = host->scale.maxprocesses;
+    p->maxpages = host->scale.maxprocpages;
+    p->pagesize = host->scale.pagesize;
+    p->physical = host->scale.physicalpages;
+    p->reserve = p->maxprocs / 2;
+    p->nslots = p->maxprocs * p->maxpages;
+    p->state = calloc(p->nslots, sizeof(char));
+    p->wanted = calloc(p->nslots, sizeof(int));
+    p->depth = host->scale.pagewait / p->pagesize + 1;
+    p->maxwant = MAXWANT + p->depth - 1;
+    p->want = malloc(p->maxprocs * p->maxwant * sizeof(int));
+    p->nwant = calloc(p->maxprocs, sizeof(int));
+    p->kinds = calloc(p->maxprocs, sizeof(long));
+    if(pagelist_init(&p->lru, p->nslots) || !p->state || !p->wanted
+       || !p->want || !p->nwant || !p->kinds){
+        perror("Error on predict Malloc");
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+static void predict_fini(void *state)
+{
+    struct predict *p = state;
+    long k;
 
-    int process_counter;
-    int page_counter;
+    for (k = 0; k < p->nkinds; k++)
+    {
+        free(p->trans[k]);
+    }
+    free(p->trans);
+    free(p->seen);
+    pagelist_free(&p->lru);
+    free(p->state);
+    free(p->wanted);
+    free(p->want);
+    free(p->nwant);
+    free(p->kinds);
+    free(p);
+}
+
+/* make room in the model for a program kind not seen before */
+static void predict_kind(struct predict *p, long kind)
+{
+    long k;
+    int page;
+
+    if (kind < p->nkinds)
+    {
+        return;
+    }
+    p->trans = realloc(p->trans, (kind + 1) * sizeof(int *));
+    p->seen = realloc(p->seen, (kind + 1) * p->maxpages * sizeof(int));
+    if(!p->trans || !p->seen){
+        perror("Error on predict Malloc");
+        exit(EXIT_FAILURE);
+    }
+    for (k = p->nkinds; k <= kind; k++)
+    {
+        p->trans[k] = calloc(p->maxpages * p->maxpages, sizeof(int));
+        if(!p->trans[k]){
+            perror("Error on predict Malloc");
+            exit(EXIT_FAILURE);
+        }
+        for (page = 0; page < p->maxpages; page++)
+        {
+            p->seen[k * p->maxpages + page] = 0;
+        }
+    }
+    p->nkinds = kind + 1;
+}
 
-    int process_page;
-    int max = INT_MAX;
+/* drop every page a process wanted; resident ones become evictable */
+static void predict_unwant(struct predict *p, int proc)
+{
+    int i;
+    int slot;
 
-    int l;
-    int l_i;
+    for (i = 0; i < p->nwant[proc]; i++)
+    {
+        slot = SLOT(p, proc, p->want[proc * p->maxwant + i]);
+        p->wanted[slot] = 0;
+        if (p->state[slot] == PAGE_RESIDENT)
+        {
+            pagelist_append(&p->lru, slot);
+        }
+    }
+    p->nwant[proc] = 0;
+}
 
+static void predict_want(struct predict *p, int proc, int page)
+{
+    int i;
+    int slot = SLOT(p, proc, page);
 
-    /* initialize static vars on first run */
-    if(!initialized){
-    for(proctmp=0; proctmp < MAXPROCESSES; proctmp++){
-        for(pagetmp=0; pagetmp < MAXPROCPAGES; pagetmp++){
-        timestamps[proctmp][pagetmp] = 0; 
+    if (page < 0 || page >= p->maxpages)
+    {
+        return;
+    }
+    for (i = 0; i < p->nwant[proc]; i++)
+    {
+        if (p->want[proc * p->maxwant + i] == page)
+        {
+            return;
         }
     }
-    initialized = 1;
+    p->want[proc * p->maxwant + p->nwant[proc]++] = page;
+    p->wanted[slot] = 1;
+    if (pagelist_linked(&p->lru, slot))
+    {
+        pagelist_unlink(&p->lru, slot);
+    }
+}
+
+/* the page most likely to follow page, -1 if none ever has */
+static int predict_likeliest(struct predict *p, long kind, int page)
+{
+    int to;
+    int best = -1;
+    int bestcount = 0;
+
+    if (p->seen[kind * p->maxpages + page] < MINSEEN)
+    {
+        //Not enough history yet: assume straight-line code
+        return page + 1 < p->maxpages ? page + 1 : -1;
+    }
+    for (to = 0; to < p->maxpages; to++)
+    {
+        if (TRANS(p, kind, page, to) > bestcount)
+        {
+            best = to;
+            bestcount = TRANS(p, kind, page, to);
+        }
     }
-    
+    return best;
+}
+
+/* the pc of proc is now on page: want it and its likely successors,
+ * then the likeliest path on for the rest of depth */
+static void predict_update(struct predict *p, int proc, int page)
+{
+    long kind = p->kinds[proc];
+    int total = p->seen[kind * p->maxpages + page];
+    int best;
+    int bestcount;
+    int to;
+    int count;
+    int i;
+    int step;
+    int next = page;
 
+    predict_unwant(p, proc);
+    predict_want(p, proc, page);
+
+    //Most likely successors first, while they are likely enough
+    while (total >= MINSEEN && p->nwant[proc] < MAXWANT)
+    {
+        best = -1;
+        bestcount = 0;
+        for (to = 0; to < p->maxpages; to++)
+        {
+            count = TRANS(p, kind, page, to);
+            if (count * MINSHARE < total || count <= bestcount)
+            {
+                continue;
+            }
+            for (i = 0; i < p->nwant[proc]; i++)
+            {
+                if (p->want[proc * p->maxwant + i] == to)
+                {
+                    break;
+                }
+            }
+            if (i == p->nwant[proc])
+            {
+                best = to;
+                bestcount = count;
+            }
+        }
+        if (best < 0)
+        {
+            break;
+        }
+        predict_want(p, proc, best);
+    }
+    if (total < MINSEEN)
+    {
+        predict_want(p, proc, predict_likeliest(p, kind, page));
+    }
 
-    //For all available processes
-    for (process_counter = 0; process_counter < MAXPROCESSES; process_counter++)
+    //Then on along the likeliest path, as far as a pagein takes
+    for (step = 1; step < p->depth && next >= 0; step++)
     {
-        //If process is active:
-        if (q[process_counter].active)
+        next = predict_likeliest(p, kind, next);
+        if (next >= 0)
         {
-            //Find the page of that active process
-            process_page = q[process_counter].pc / PAGESIZE;
+            predict_want(p, proc, predict_likeliest(p, kind, next));
+        }
+    }
+}
 
-            //If page HAS not been swapped out:
-            if (!q[process_counter].pages[process_page])
+/* start page-ins for wanted pages, the page under the pc before any
+ * prediction and a run of wanted pages as one transfer, then evict the least recently used unwanted pages
+ * until the free frames cover what is still missing plus a reserve */
+static void predict_service(struct predict *p)
+{
+    int proc;
+    int page;
+    int slot;
+    int i;
+    int missing = 0;
+    int victim;
+    int n;
+    int k;
+
+    for (i = 0; i < p->maxwant; i++)
+    {
+        for (proc = 0; proc < p->maxprocs; proc++)
+        {
+            if (i >= p->nwant[proc])
             {
-                //If page cannot be swapped in (must evict page)
-                if (!pagein(process_counter, process_page))
+                continue;
+            }
+            page = p->want[proc * p->maxwant + i];
+            slot = SLOT(p, proc, page);
+            if (p->state[slot] != PAGE_FREE && p->state[slot] != PAGE_OUTGOING)
+            {
+                continue;
+            }
+            if (p->nused < p->physical && p->state[slot] == PAGE_FREE)
+            {
+                //Wanted pages right after this one come in the same run
+                for (n = 1; page + n < p->maxpages && p->nused + n < p->physical
+                         && p->wanted[slot + n] && p->state[slot + n] == PAGE_FREE; n++)
+                    ;
+                n = p->host->pagein_range(proc, page, n);
+                for (k = 0; k < n; k++)
                 {
-                    l = max;
-                    l_i = 0;
-
-                    //Find a page to evict (LRU)
-                    for (page_counter = 0; page_counter < MAXPROCPAGES; page_counter++)
-                    {
-                        if (process_page != page_counter)
-                        {
-                            if (timestamps[process_counter][page_counter] > 0)
-                            {
-                                if (timestamps[process_counter][page_counter] < l)
-                                {
-                                    l = timestamps[process_counter][page_counter];
-                                    l_i = page_counter;
-                                }
-                            }
-                        }
-                    }
-                    //If pageout is able to swap out that page:
-                    if (pageout(process_counter, l_i))
-                    {
-                        //Reset timestamp to zero
-                        timestamps[process_counter][l_i] = 0;
-                    }                  
+                    p->state[slot + k] = PAGE_INCOMING;
                 }
+                p->nused += n;
+                continue;
             }
+            missing++;
+        }
+    }
+
+    while (p->physical - p->nused + p->noutgoing < missing + p->reserve
+           && (victim = pagelist_first(&p->lru)) >= 0)
+    {
+        pagelist_unlink(&p->lru, victim);
+        if (p->host->pageout(victim / p->maxpages, victim % p->maxpages))
+        {
+            p->state[victim] = PAGE_OUTGOING;
+            p->noutgoing++;
+        }
+    }
+}
+
+/* a process left its slot; the simulator freed all of its frames */
+static void predict_unload(struct predict *p, int proc)
+{
+    int page;
+    int slot;
+
+    for (page = 0; page < p->maxpages; page++)
+    {
+        slot = SLOT(p, proc, page);
+        if (p->state[slot] == PAGE_OUTGOING)
+        {
+            p->noutgoing--;
+        }
+        if (p->state[slot] != PAGE_FREE)
+        {
+            p->nused--;
+        }
+        if (pagelist_linked(&p->lru, slot))
+        {
+            pagelist_unlink(&p->lru, slot);
+        }
+        p->state[slot] = PAGE_FREE;
+        p->wanted[slot] = 0;
+    }
+    p->nwant[proc] = 0;
+}
+
+static void predict_events(void *state, Pevent events[], int nevents, long clock)
+{
+    struct predict *p = state;
+    Pevent *e;
+    int slot;
+    int i;
 
-            else
+    (void) clock;
+
+    for (i = 0; i < nevents; i++)
+    {
+        e = &events[i];
+        slot = SLOT(p, e->process, e->page);
+        switch (e->type)
+        {
+        case PAGER_LOAD:
+            predict_kind(p, e->kind);
+            p->kinds[e->process] = e->kind;
+            predict_update(p, e->process, e->pc / p->pagesize);
+            break;
+
+        case PAGER_UNLOAD:
+            predict_unload(p, e->process);
+            break;
+
+        case PAGER_FAULT:
+            //Already wanted as the current page; serviced below
+            break;
+
+        case PAGER_PCPAGE:
+            TRANS(p, e->kind, e->prevpage, e->page)++;
+            p->seen[e->kind * p->maxpages + e->prevpage]++;
+            predict_update(p, e->process, e->page);
+            break;
+
+        case PAGER_PAGEIN_DONE:
+            p->state[slot] = PAGE_RESIDENT;
+            if (!p->wanted[slot])
             {
-                //Update timestamp to tick
-                timestamps[process_counter][process_page] = tick;
+                pagelist_append(&p->lru, slot);
             }
+            break;
+
+        case PAGER_PAGEOUT_DONE:
+            p->state[slot] = PAGE_FREE;
+            p->noutgoing--;
+            p->nused--;
+            break;
         }
     }
 
+    predict_service(p);
+}
 
-    /* advance time for next pageit iteration */
-    tick++;
-} 
\ No newline at end of file
+const struct pagerops pager_plugin = {
+    PAGER_ABI, "predict", predict_init, predict_events, NULL, predict_fini
+};
@@ -0,0 +1,338 @@
+/*
+ * File: pager-ws.c
+ *
+ * Project: CSCI 3753 Programming Assignment 4
+ * Description:
+ * 	This file contains a working-set pageit
+ *      implementation. It is a pager plugin: linked into test-ws,
+ *      or built as pager-ws.so for -pager.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "simulator.h"
+#include "pagelist.h"
+
+/* Page states as this pager sees them */
+#define PAGE_FREE     0 // not in memory
+#define PAGE_INCOMING 1 // pagein started
+#define PAGE_RESIDENT 2 // in memory
+#define PAGE_OUTGOING 3 // pageout started, frame not yet free
+
+#define SLOT(w, proc, page) ((proc) * (w)->maxpages + (page))
+
+/* A process's working set is its current page plus every page its pc
+ * has left within the last tau ticks. Pages that fall out of the
+ * window are paged out as soon as they do, whether or not anyone is
+ * short of frames, so each process holds only as many frames as its
+ * locality needs and the rest stay free for faults.
+ *
+ * Each process's frames are also held to a budget. While the working
+ * sets together fit in the frames outside the reserve, a process may
+ * hold its whole working set and grow it by faulting. Once they don't,
+ * each process gets a share of those frames in proportion to the size
+ * of its working set, and a process at its share that faults gives up
+ * its own oldest page for the new one rather than taking a free frame
+ * another process's working set needs.
+ *
+ * Resident pages other than current ones sit on one list in the order
+ * their pcs left them, which is also the order they leave the window:
+ * the first page on it expires first. */
+struct ws
+{
+    const struct pagerhost *host;
+    int maxprocs;
+    int maxpages;
+    long pagesize;
+    long physical;
+    long tau;        // working set window, in ticks; longer than
+                     // the longest loop in programs.c
+    int reserve;     // frames kept free for faults
+    int nslots;
+    struct pagelist window;
+    long *lastuse;   // when the pc last left each page
+    char *state;     // maxprocs x maxpages
+    int *current;    // page under each process's pc, -1 if none
+    int *pending;    // page each process is blocked on, -1 if none
+    int *budget;     // frames each process holds
+    int *outgoing;   // of those, frames on their way to being free
+    int *wsize;      // pages each process has on the window list
+    int nwsize;      // working set pages of every process together
+    int nactive;     // processes loaded
+    int npending;
+    int nused;       // frames incoming, resident or outgoing
+    int noutgoing;   // frames on their way to being free
+};
+
+static void *ws_init(const struct pagerhost *host)
+{
+    struct ws *w;
+    int i;
+
+    w = calloc(1, sizeof(struct ws));
+    if(!w){
+        perror("Error on working set Malloc");
+        exit(EXIT_FAILURE);
+    }
+    w->host = host;
+    w->maxprocs = host->scale.maxprocesses;
+    w->maxpages = host->scale.maxprocpages;
+    w->pagesize = host->scale.pagesize;
+    w->physical = host->scale.physicalpages;
+    w->tau = 16 * w->pagesize;
+    w->reserve = w->maxprocs / 2;
+    w->nslots = w->maxprocs * w->maxpages;
+    w->lastuse = calloc(w->nslots, sizeof(long));
+    w->state = calloc(w->nslots, sizeof(char));
+    w->current = malloc(w->maxprocs * sizeof(int));
+    w->pending = malloc(w->maxprocs * sizeof(int));
+    w->budget = calloc(w->maxprocs, sizeof(int));
+    w->outgoing = calloc(w->maxprocs, sizeof(int));
+    w->wsize = calloc(w->maxprocs, sizeof(int));
+    if(pagelist_init(&w->window, w->nslots) || !w->lastuse || !w->state
+       || !w->current || !w->pending || !w->budget || !w->outgoing
+       || !w->wsize){
+        perror("Error on working set Malloc");
+        exit(EXIT_FAILURE);
+    }
+    for(i = 0; i < w->maxprocs; i++)
+    {
+        w->current[i] = w->pending[i] = -1;
+    }
+    return w;
+}
+
+static void ws_fini(void *state)
+{
+    struct ws *w = state;
+
+    pagelist_free(&w->window);
+    free(w->lastuse);
+    free(w->state);
+    free(w->current);
+    free(w->pending);
+    free(w->budget);
+    free(w->outgoing);
+    free(w->wsize);
+    free(w);
+}
+
+/* the pc left a page at clock: it stays in the working set for tau */
+static void ws_touch(struct ws *w, int slot, long clock)
+{
+    if (!pagelist_linked(&w->window, slot))
+    {
+        w->wsize[slot / w->maxpages]++;
+        w->nwsize++;
+    }
+    w->lastuse[slot] = clock;
+    pagelist_append(&w->window, slot);
+}
+
+/* take a page off the window list, if it is on it */
+static void ws_drop(struct ws *w, int slot)
+{
+    if (pagelist_linked(&w->window, slot))
+    {
+        pagelist_unlink(&w->window, slot);
+        w->wsize[slot / w->maxpages]--;
+        w->nwsize--;
+    }
+}
+
+static void ws_evict(struct ws *w, int slot)
+{
+    ws_drop(w, slot);
+    if (w->host->pageout(slot / w->maxpages, slot % w->maxpages))
+    {
+        w->state[slot] = PAGE_OUTGOING;
+        w->outgoing[slot / w->maxpages]++;
+        w->noutgoing++;
+    }
+}
+
+/* frames proc may hold, counting its current page as part of its
+ * working set: all it wants while every working set fits, else its
+ * share of the frames outside the reserve */
+static int ws_quota(struct ws *w, int proc)
+{
+    long avail = w->physical - w->reserve;
+    long total = w->nwsize + w->nactive;
+    long share;
+
+    if (total <= avail)
+    {
+        return w->physical;
+    }
+    share = avail * (w->wsize[proc] + 1) / total;
+    return share > 1 ? share : 1;
+}
+
+/* the page proc's pc left longest ago, -1 if it has none listed */
+static int ws_oldest(struct ws *w, int proc)
+{
+    int page;
+    int slot;
+    int best = -1;
+
+    for (page = 0; page < w->maxpages; page++)
+    {
+        slot = SLOT(w, proc, page);
+        if (pagelist_linked(&w->window, slot)
+            && (best < 0 || w->lastuse[slot] < w->lastuse[best]))
+        {
+            best = slot;
+        }
+    }
+    return best;
+}
+
+/* trim every working set to its window, then start page-ins for
+ * blocked processes while frames are free; one at its budget pages
+ * out its own oldest page instead, and faults again into the frame
+ * once it is on its way out. If the working sets don't
+ * leave enough frames for the faults still waiting plus a reserve,
+ * the oldest pages go early, so the pager degrades to global LRU
+ * rather than letting blocked processes wait for pages to age out */
+static void ws_service(struct ws *w, long clock)
+{
+    int proc;
+    int victim;
+
+    while ((victim = pagelist_first(&w->window)) >= 0
+           && w->lastuse[victim] + w->tau < clock)
+    {
+        ws_evict(w, victim);
+    }
+
+    for (proc = 0; proc < w->maxprocs && w->npending > 0; proc++)
+    {
+        if (w->pending[proc] < 0 || w->nused == w->physical)
+        {
+            continue;
+        }
+        if (w->budget[proc] - w->outgoing[proc] >= ws_quota(w, proc))
+        {
+            victim = ws_oldest(w, proc);
+            if (victim >= 0)
+            {
+                ws_evict(w, victim);
+                continue;
+            }
+            if (w->outgoing[proc] > 0)
+            {
+                continue; // its own frame is on the way
+            }
+        }
+        if (w->host->pagein(proc, w->pending[proc]))
+        {
+            w->state[SLOT(w, proc, w->pending[proc])] = PAGE_INCOMING;
+            w->pending[proc] = -1;
+            w->npending--;
+            w->budget[proc]++;
+            w->nused++;
+        }
+    }
+
+    while (w->physical - w->nused + w->noutgoing < w->npending + w->reserve
+           && (victim = pagelist_first(&w->window)) >= 0)
+    {
+        ws_evict(w, victim);
+    }
+}
+
+/* a process left its slot; the simulator freed all of its frames */
+static void ws_unload(struct ws *w, int proc)
+{
+    int page;
+    int slot;
+
+    for (page = 0; page < w->maxpages; page++)
+    {
+        slot = SLOT(w, proc, page);
+        if (w->state[slot] == PAGE_OUTGOING)
+        {
+            w->noutgoing--;
+        }
+        ws_drop(w, slot);
+        w->state[slot] = PAGE_FREE;
+    }
+    if (w->current[proc] >= 0)
+    {
+        w->nactive--;
+    }
+    if (w->pending[proc] >= 0)
+    {
+        w->npending--;
+    }
+    w->nused -= w->budget[proc];
+    w->budget[proc] = 0;
+    w->outgoing[proc] = 0;
+    w->pending[proc] = -1;
+    w->current[proc] = -1;
+}
+
+static void ws_events(void *state, Pevent events[], int nevents, long clock)
+{
+    struct ws *w = state;
+    Pevent *e;
+    int slot;
+    int i;
+
+    for (i = 0; i < nevents; i++)
+    {
+        e = &events[i];
+        slot = SLOT(w, e->process, e->page);
+        switch (e->type)
+        {
+        case PAGER_LOAD:
+            w->current[e->process] = e->pc / w->pagesize;
+            w->nactive++;
+            break;
+
+        case PAGER_UNLOAD:
+            ws_unload(w, e->process);
+            break;
+
+        case PAGER_FAULT:
+            if (w->pending[e->process] < 0)
+            {
+                w->npending++;
+            }
+            w->pending[e->process] = e->page;
+            break;
+
+        case PAGER_PCPAGE:
+            if (w->state[SLOT(w, e->process, e->prevpage)] == PAGE_RESIDENT)
+            {
+                ws_touch(w, SLOT(w, e->process, e->prevpage), clock);
+            }
+            ws_drop(w, slot);
+            w->current[e->process] = e->page;
+            break;
+
+        case PAGER_PAGEIN_DONE:
+            w->state[slot] = PAGE_RESIDENT;
+            if (w->current[e->process] != e->page)
+            {
+                ws_touch(w, slot, clock);
+            }
+            break;
+
+        case PAGER_PAGEOUT_DONE:
+            w->state[slot] = PAGE_FREE;
+            w->noutgoing--;
+            w->outgoing[e->process]--;
+            w->budget[e->process]--;
+            w->nused--;
+            break;
+        }
+    }
+
+    ws_service(w, clock);
+}
+
+const struct pagerops pager_plugin = {
+    PAGER_ABI, "ws", ws_init, ws_events, NULL, ws_fini
+};
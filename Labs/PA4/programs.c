@@ -10,45 +10,45 @@
  * Create Date: Unknown
  * Modify Date: 2012/04/03
  * Description:
- * 	This file defines the programs run by the simulator
+ * 	This file defines the programs run by the simulator unless
+ *      -workload names others; default.workload is the same set.
  */
 
 
 #define PROGRAMS 5
-static Program programs[PROGRAMS] = {
+static Program defaultprograms[PROGRAMS] = {
     { 1535, 3,
-      {
+      (Branch[]) {
 	  {500, 1402, IF, 0, 0, 0.6, 0 },
 	  {1401, 1533, GOTO, 0, 0, 1, 0 },
 	  {1533, 0, FOR, 10, 30, 0, 0 },
       },
-      1, { 1534, }
+      1, (long[]) { 1534, }, 1, NULL
     },
     { 1131, 1,
-      {
+      (Branch[]) {
 	  {1129, 0, FOR, 20, 50, 0, 0 },
       },
-      1, { 1130, }
+      1, (long[]) { 1130, }, 1, NULL
     },
     { 1685, 2,
-      {
+      (Branch[]) {
 	  {1682, 1166, FOR, 10, 20, 0, 0 },
 	  {1683, 0, FOR, 10, 20, 0, 0 },
       },
-      1, { 1684, }
+      1, (long[]) { 1684, }, 1, NULL
     },
     { 1912, 0,
-      {
-      },
-      1, { 1911, }
+      NULL,
+      1, (long[]) { 1911, }, 1, NULL
     },
     { 505, 4,
-      {
+      (Branch[]) {
 	  {500, 503, IF, 0, 0, 0.5, 0 },
 	  {501, 0, GOTO, 0, 0, 1, 0 },
 	  {502, 503, GOTO, 0, 0, 1, 0 },
 	  {503, 0, FOR, 10, 20, 0, 0 },
       },
-      1, { 504, }
+      1, (long[]) { 504, }, 1, NULL
     },
 };
@@ -0,0 +1,256 @@
+/*
+ * File: replay.c
+ *
+ * Project: CSCI 3753 Programming Assignment 4
+ * Description:
+ * 	Page reference trace reader for -replay. The trace is mapped
+ *      once and scanned once to find where each job's runs start and
+ *      end and to check them; after that each running job keeps its
+ *      own position in the mapping and reads a run whenever it moves
+ *      on to another page.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "replay.h"
+
+#define REPLAY_BAD -1
+#define REPLAY_SKIP 0
+#define REPLAY_RUN 1
+
+/* read one number from a text line */
+static int replay_number(const char **pos, const char *end, long *value)
+{
+    const char *p = *pos;
+    int negative = 0;
+    long v = 0;
+
+    while (p < end && (*p == ' ' || *p == '\t')) {
+	p++;
+    }
+    if (p < end && *p == '-') {
+	negative = 1;
+	p++;
+    }
+    if (p == end || *p < '0' || *p > '9') {
+	return REPLAY_BAD;
+    }
+    while (p < end && *p >= '0' && *p <= '9') {
+	if (v > (LONG_MAX - 9) / 10) {
+	    return REPLAY_BAD;
+	}
+	v = v * 10 + (*p++ - '0');
+    }
+    *pos = p;
+    *value = negative ? -v : v;
+    return REPLAY_RUN;
+}
+
+/* read one text line: a run "pid kind page ticks", or a blank line or
+ * comment to skip. *pos is left at the start of the next line */
+static int replay_line(const char **pos, const char *end, long v[4])
+{
+    const char *p = *pos;
+    const char *eol = memchr(p, '\n', end - p);
+    int i;
+
+    if (!eol) {
+	eol = end;
+    }
+    *pos = eol < end ? eol + 1 : end;
+    while (p < eol && (*p == ' ' || *p == '\t' || *p == '\r')) {
+	p++;
+    }
+    if (p == eol || *p == '#') {
+	return REPLAY_SKIP;
+    }
+    for (i = 0; i < 4; i++) {
+	if (replay_number(&p, eol, &v[i]) != REPLAY_RUN) {
+	    return REPLAY_BAD;
+	}
+    }
+    while (p < eol && (*p == ' ' || *p == '\t' || *p == '\r')) {
+	p++;
+    }
+    return p == eol ? REPLAY_RUN : REPLAY_BAD;
+}
+
+/* read the run at *pos as pid, kind, page, ticks */
+static int replay_read(const Replay *r, const char **pos, const char *end,
+		       long v[4])
+{
+    const struct replayrec *rec;
+    int rc;
+
+    if (r->binary) {
+	if (*pos >= end) {
+	    return REPLAY_SKIP;
+	}
+	rec = (const struct replayrec *) *pos;
+	*pos += sizeof(struct replayrec);
+	v[0] = rec->pid;
+	v[1] = rec->kind;
+	v[2] = rec->page;
+	v[3] = rec->ticks;
+	return REPLAY_RUN;
+    }
+    while (*pos < end) {
+	rc = replay_line(pos, end, v);
+	if (rc != REPLAY_SKIP) {
+	    return rc;
+	}
+    }
+    return REPLAY_SKIP;
+}
+
+/* split the trace into jobs, checking every run on the way */
+static int replay_scan(Replay *r, const char *path, long maxpages)
+{
+    const char *pos = r->map;
+    const char *end = r->map + r->size;
+    const char *start;
+    long v[4];
+    long line = 0;
+    long maxjobs = 0;
+    int rc;
+    struct replayjob *jb;
+
+    if (r->binary) {
+	pos += sizeof(struct replayheader);
+	if ((end - pos) % sizeof(struct replayrec)) {
+	    fprintf(stderr, "%s: truncated reference trace\n", path);
+	    return -1;
+	}
+    }
+    for (;;) {
+	start = pos;
+	if (r->binary) {
+	    rc = replay_read(r, &pos, end, v);
+	    line++;
+	} else {
+	    do {
+		rc = pos < end ? replay_line(&pos, end, v) : REPLAY_SKIP;
+		line++;
+	    } while (rc == REPLAY_SKIP && pos < end);
+	}
+	if (rc == REPLAY_SKIP) {
+	    break;
+	}
+	if (rc == REPLAY_BAD) {
+	    fprintf(stderr, "%s:%ld: expected pid kind page ticks\n",
+		    path, line);
+	    return -1;
+	}
+	if (v[0] < 0 || v[1] < 0 || v[1] > REPLAY_MAXKIND
+	    || v[2] < 0 || v[2] >= maxpages || v[3] < 1) {
+	    fprintf(stderr, "%s:%ld: run out of range"
+		    " (kind 0-%d, page 0-%ld, ticks >0)\n",
+		    path, line, REPLAY_MAXKIND, maxpages - 1);
+	    return -1;
+	}
+	jb = r->njobs ? &r->jobs[r->njobs - 1] : NULL;
+	if (jb && jb->pid == v[0]) {
+	    jb->end = pos;
+	    continue;
+	}
+	if (r->njobs == maxjobs) {
+	    maxjobs = maxjobs ? 2 * maxjobs : 64;
+	    r->jobs = realloc(r->jobs, maxjobs * sizeof(struct replayjob));
+	    if (!r->jobs) {
+		perror("Error on replay Malloc");
+		return -1;
+	    }
+	}
+	jb = &r->jobs[r->njobs++];
+	jb->start = start;
+	jb->end = pos;
+	jb->pid = v[0];
+	jb->kind = v[1];
+    }
+    if (r->njobs == 0) {
+	fprintf(stderr, "%s: no runs in reference trace\n", path);
+	return -1;
+    }
+    return 0;
+}
+
+Replay *replay_open(const char *path, long maxpages)
+{
+    Replay *r;
+    struct stat st;
+    struct replayheader h;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) < 0) {
+	perror(path);
+	if (fd >= 0) {
+	    close(fd);
+	}
+	return NULL;
+    }
+    if (st.st_size == 0) {
+	fprintf(stderr, "%s: empty reference trace\n", path);
+	close(fd);
+	return NULL;
+    }
+    r = calloc(1, sizeof(Replay));
+    if (!r) {
+	perror("Error on replay Malloc");
+	close(fd);
+	return NULL;
+    }
+    r->size = st.st_size;
+    r->map = mmap(NULL, r->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (r->map == MAP_FAILED) {
+	perror(path);
+	free(r);
+	return NULL;
+    }
+    /* every job is read front to back, so let the kernel read ahead */
+    madvise(r->map, r->size, MADV_SEQUENTIAL);
+
+    if (r->size >= sizeof(h) && !memcmp(r->map, REPLAY_MAGIC, 8)) {
+	memcpy(&h, r->map, sizeof(h));
+	if (h.version != REPLAY_VERSION
+	    || h.recsize != sizeof(struct replayrec)) {
+	    fprintf(stderr, "%s: unsupported reference trace version\n", path);
+	    replay_close(r);
+	    return NULL;
+	}
+	r->binary = 1;
+    }
+    if (replay_scan(r, path, maxpages) < 0) {
+	replay_close(r);
+	return NULL;
+    }
+    return r;
+}
+
+int replay_next(const Replay *r, const char **pos, const char *end,
+		long *page, long *ticks)
+{
+    long v[4];
+
+    if (replay_read(r, pos, end, v) != REPLAY_RUN) {
+	return 0;
+    }
+    *page = v[2];
+    *ticks = v[3];
+    return 1;
+}
+
+void replay_close(Replay *r)
+{
+    munmap(r->map, r->size);
+    free(r->jobs);
+    free(r);
+}
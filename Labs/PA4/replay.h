@@ -0,0 +1,71 @@
+/*
+ * File: replay.h
+ *
+ * Project: CSCI 3753 Programming Assignment 4
+ * Description:
+ * 	Page reference traces for the simulator's -replay mode. A
+ *      trace is a list of runs, each a number of ticks a job spends
+ *      on one page, grouped by job. It is either text in the format
+ *      -reftrace writes:
+ *          # pid kind page ticks
+ *          0 3 0 57
+ *      or binary: a header followed by struct replayrec records, as
+ *      written by lackey2ref. Either way the file is mapped rather
+ *      than read, so a trace much larger than memory is paged in as
+ *      the jobs reach it.
+ */
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define REPLAY_MAGIC "PA4REFS"
+#define REPLAY_VERSION 1
+#define REPLAY_MAXKIND 255
+
+struct replayheader {
+    char magic[8];
+    uint32_t version;
+    uint32_t recsize;
+};
+
+struct replayrec {
+    int32_t pid;
+    int32_t kind;
+    int32_t page;
+    int32_t ticks;
+};
+
+/* One job: the runs from start up to end, all with the same pid */
+struct replayjob {
+    const char *start;
+    const char *end;
+    long pid;
+    long kind;
+};
+
+typedef struct replay {
+    char *map;
+    size_t size;
+    int binary;
+    long njobs;
+    struct replayjob *jobs;
+} Replay;
+
+/* Function to map a trace and find its jobs, checking every run
+ * against maxpages. Prints what is wrong and returns NULL on failure
+ */
+Replay *replay_open(const char *path, long maxpages);
+
+/* Function to read the run at *pos, if it is before end, and move
+ * *pos past it. Returns 1 if a run was read, 0 at the end of a job
+ */
+int replay_next(const Replay *r, const char **pos, const char *end,
+		long *page, long *ticks);
+
+/* Function to unmap a trace */
+void replay_close(Replay *r);
+
+#endif
@@ -0,0 +1,316 @@
+/*
+ * File: runner.c
+ *
+ * Project: CSCI 3753 Programming Assignment 4
+ * Description:
+ * 	Batch runner for the paging simulator. Runs each pager binary
+ *      over a range of seeds, several runs at a time, and reports the
+ *      blocked/compute ratio of every pager as mean, standard
+ *      deviation, minimum and maximum. Each run is its own process,
+ *      so pagers that keep their state in statics stay isolated.
+ *
+ * Usage:
+ *      sim-runner [-seeds n] [-first s] [-jobs j] [-args "..."]
+ *                 [-optimal test-opt] pager...
+ *
+ *      With -optimal, the offline pager runs on every seed too, fed
+ *      that seed's reference trace, and each pager's mean gap to it
+ *      is reported.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#define MAXARGS 64 	/* extra simulator arguments per run */
+#define TAILSIZE 4096 	/* keep this much of each run's log */
+
+/* one simulator run in flight */
+struct run {
+    pid_t pid;
+    int fd; 		/* read end of the run's stderr */
+    long pager; 	/* index into the pager list */
+    long seed;
+    char trace[64]; 	/* reference trace for the optimal pager */
+    char tail[TAILSIZE];
+    long ntail;
+};
+
+/* results for one pager */
+struct score {
+    const char *name;
+    long runs;
+    long failed;
+    double sum, sumsq;
+    double min, max;
+    double *ratio; 	/* per seed, NAN if the run failed */
+};
+
+static char *extra[MAXARGS];
+static long nextra=0;
+
+/* start one run; its stdout is discarded, stderr comes back on fd.
+   An optimal run writes the reference trace and reads it back. */
+static int run_start(struct run *r, const char *pager, long seed,
+		     int optimal) {
+    int fds[2];
+    int null;
+    char seedstr[32];
+    char *argv[MAXARGS+8];
+    long i,n=0;
+
+    r->trace[0] = '\0';
+    if (optimal)
+	snprintf(r->trace, sizeof(r->trace), "/tmp/sim-runner.%ld.%ld.trace",
+		 (long) getpid(), seed);
+    if (pipe(fds)<0) { perror("pipe"); return -1; }
+    r->pid = fork();
+    if (r->pid<0) {
+	perror("fork");
+	close(fds[0]); close(fds[1]);
+	return -1;
+    }
+    if (r->pid==0) {
+	null = open("/dev/null", O_WRONLY);
+	if (null>=0) dup2(null, STDOUT_FILENO);
+	dup2(fds[1], STDERR_FILENO);
+	close(fds[0]); close(fds[1]);
+	snprintf(seedstr, sizeof(seedstr), "%ld", seed);
+	argv[n++] = (char *) pager;
+	argv[n++] = "-seed";
+	argv[n++] = seedstr;
+	for (i=0; i<nextra; i++) argv[n++] = extra[i];
+	if (r->trace[0]) {
+	    argv[n++] = "-reftrace";
+	    argv[n++] = r->trace;
+	    argv[n++] = "-pagerarg";
+	    argv[n++] = r->trace;
+	}
+	argv[n] = NULL;
+	execvp(pager, argv);
+	fprintf(stderr, "cannot run %s: %s\n", pager, strerror(errno));
+	_exit(127);
+    }
+    close(fds[1]);
+    r->fd = fds[0];
+    r->seed = seed;
+    r->ntail = 0;
+    return 0;
+}
+
+/* drain a run's stderr into its tail buffer; 0 at end of file */
+static int run_read(struct run *r) {
+    char buf[TAILSIZE];
+    ssize_t got = read(r->fd, buf, sizeof(buf));
+    if (got<0 && errno==EINTR) return 1;
+    if (got<=0) return 0;
+    if (r->ntail+got > TAILSIZE-1) {
+	long drop = r->ntail+got-(TAILSIZE-1);
+	if (drop>r->ntail) drop=r->ntail;
+	memmove(r->tail, r->tail+drop, r->ntail-drop);
+	r->ntail -= drop;
+    }
+    if (got > TAILSIZE-1) {
+	memcpy(r->tail, buf+got-(TAILSIZE-1), TAILSIZE-1);
+	r->ntail = TAILSIZE-1;
+    } else {
+	memcpy(r->tail+r->ntail, buf, got);
+	r->ntail += got;
+    }
+    return 1;
+}
+
+/* reap a finished run and score it from the end of its log */
+static void run_finish(struct run *r, struct score *s, long first) {
+    int status, matched;
+    long block=-1, compute=-1, value;
+    double ratio;
+    char *line;
+
+    close(r->fd);
+    while (waitpid(r->pid, &status, 0)<0 && errno==EINTR) ;
+    if (r->trace[0]) unlink(r->trace);
+    r->tail[r->ntail] = '\0';
+    for (line=r->tail; line; line=strchr(line, '\n')) {
+	if (*line=='\n') line++;
+	/* %n is only stored once the whole pattern has matched */
+	matched = 0;
+	sscanf(line, "%*d: %ld blocked cycles%n", &value, &matched);
+	if (matched) block=value;
+	matched = 0;
+	sscanf(line, "%*d: %ld compute cycles%n", &value, &matched);
+	if (matched) compute=value;
+    }
+    if (!WIFEXITED(status) || WEXITSTATUS(status)!=0
+     || block<0 || compute<=0) {
+	fprintf(stderr, "%s -seed %ld failed\n", s->name, r->seed);
+	s->failed++;
+	return;
+    }
+    ratio = (double)block/(double)compute;
+    s->ratio[r->seed-first] = ratio;
+    if (s->runs==0 || ratio<s->min) s->min=ratio;
+    if (s->runs==0 || ratio>s->max) s->max=ratio;
+    s->sum += ratio;
+    s->sumsq += ratio*ratio;
+    s->runs++;
+}
+
+/* split the -args string into separate simulator arguments */
+static void split_args(char *args) {
+    char *word;
+    for (word=strtok(args, " \t"); word; word=strtok(NULL, " \t")) {
+	if (nextra==MAXARGS) {
+	    fprintf(stderr, "too many simulator arguments\n");
+	    exit(EXIT_FAILURE);
+	}
+	extra[nextra++] = word;
+    }
+}
+
+static void usage(const char *name) {
+    fprintf(stderr,
+	"usage: %s [-seeds n] [-first s] [-jobs j] [-args \"...\"]\n"
+	"          [-optimal test-opt] pager...\n"
+	"   -seeds n  run each pager with n seeds (default 20)\n"
+	"   -first s  first seed to use (default 1)\n"
+	"   -jobs j   simulator runs at once (default: online CPUs)\n"
+	"   -args a   extra arguments passed to every run\n"
+	"   -optimal p  also run offline pager p and report gaps to it\n",
+	name);
+}
+
+int main(int argc, char **argv) {
+    long seeds=20, first=1, jobs;
+    long npagers, total, started=0, running=0;
+    long i,j,k;
+    long nscores, gaps, seed;
+    double gap;
+    const char *optimal=NULL;
+    struct score *scores;
+    struct run *runs;
+    struct pollfd *fds;
+
+    jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    if (jobs<1) jobs=1;
+
+    for (i=1; i<argc && argv[i][0]=='-'; i++) {
+	if (!strcmp(argv[i],"-seeds") && i+1<argc) {
+	    seeds = atol(argv[++i]);
+	} else if (!strcmp(argv[i],"-first") && i+1<argc) {
+	    first = atol(argv[++i]);
+	} else if (!strcmp(argv[i],"-jobs") && i+1<argc) {
+	    jobs = atol(argv[++i]);
+	} else if (!strcmp(argv[i],"-optimal") && i+1<argc) {
+	    optimal = argv[++i];
+	} else if (!strcmp(argv[i],"-args") && i+1<argc) {
+	    split_args(argv[++i]);
+	} else {
+	    usage(argv[0]);
+	    return EXIT_FAILURE;
+	}
+    }
+    npagers = argc-i;
+    if (npagers<1 || seeds<1 || jobs<1) {
+	usage(argv[0]);
+	return EXIT_FAILURE;
+    }
+
+    /* the optimal pager, if any, is scored last */
+    nscores = npagers + (optimal ? 1 : 0);
+    scores = calloc(nscores, sizeof(struct score));
+    runs = calloc(jobs, sizeof(struct run));
+    fds = calloc(jobs, sizeof(struct pollfd));
+    if (!scores || !runs || !fds) {
+	fprintf(stderr, "out of memory\n");
+	return EXIT_FAILURE;
+    }
+    for (j=0; j<nscores; j++) {
+	scores[j].name = j<npagers ? argv[i+j] : optimal;
+	scores[j].ratio = malloc(seeds*sizeof(double));
+	if (!scores[j].ratio) {
+	    fprintf(stderr, "out of memory\n");
+	    return EXIT_FAILURE;
+	}
+	for (k=0; k<seeds; k++) scores[j].ratio[k] = NAN;
+    }
+
+    /* seeds are handed out pager by pager; runs[0..running) are live */
+    total = nscores*seeds;
+    while (started<total || running>0) {
+	while (started<total && running<jobs) {
+	    struct run *r = runs+running;
+	    r->pager = started/seeds;
+	    if (run_start(r, scores[r->pager].name, first+started%seeds,
+			  r->pager==npagers)<0) {
+		scores[r->pager].failed++;
+	    } else {
+		running++;
+	    }
+	    started++;
+	}
+	if (running==0) continue;
+
+	for (j=0; j<running; j++) {
+	    fds[j].fd = runs[j].fd;
+	    fds[j].events = POLLIN;
+	    fds[j].revents = 0;
+	}
+	if (poll(fds, running, -1)<0) {
+	    if (errno==EINTR) continue;
+	    perror("poll");
+	    return EXIT_FAILURE;
+	}
+	for (j=running-1; j>=0; j--) {
+	    if (!fds[j].revents) continue;
+	    if (!run_read(runs+j)) {
+		run_finish(runs+j, scores+runs[j].pager, first);
+		runs[j] = runs[--running];
+	    }
+	}
+    }
+
+    printf("%-24s %6s %10s %10s %10s %10s",
+	   "pager", "runs", "mean", "stddev", "min", "max");
+    if (optimal) printf(" %10s", "gap");
+    printf("\n");
+    for (j=0; j<nscores; j++) {
+	struct score *s = scores+j;
+	double mean=0, var=0;
+	if (s->runs>0) {
+	    mean = s->sum/s->runs;
+	    var = s->sumsq/s->runs - mean*mean;
+	    if (var<0) var=0;
+	}
+	printf("%-24s %6ld %10.6f %10.6f %10.6f %10.6f",
+	       s->name, s->runs, mean, sqrt(var), s->min, s->max);
+	if (optimal) {
+	    /* mean over the seeds both this pager and optimal finished */
+	    gap = 0;
+	    gaps = 0;
+	    for (seed=0; seed<seeds; seed++) {
+		if (isnan(s->ratio[seed]) || isnan(scores[npagers].ratio[seed]))
+		    continue;
+		gap += s->ratio[seed]-scores[npagers].ratio[seed];
+		gaps++;
+	    }
+	    printf(" %10.6f", gaps ? gap/gaps : NAN);
+	}
+	if (s->failed) printf("  (%ld failed)", s->failed);
+	printf("\n");
+    }
+
+    for (j=0; j<nscores; j++) free(scores[j].ratio);
+    free(scores);
+    free(runs);
+    free(fds);
+    return EXIT_SUCCESS;
+}
@@ -20,19 +20,32 @@
 #include <stdarg.h> 
 #include <signal.h>
 #include <time.h> 
+#include <pthread.h> 
+#include <dlfcn.h> 
 
 #include "simulator.h"
+#include "trace.h"
+#include "replay.h"
+#include "workload.h"
+#include "stats.h"
+#include "swapdev.h"
+
+/* a pager defines pageit(), pageit_events(), or both, or is a plugin */
+#pragma weak pageit
+#pragma weak pageit_events
+#pragma weak pager_plugin
+
+#define MAXPAGERS 16 	/* -pager plugins compared in one run */ 
+#define LOADCTL_PATIENCE 4 	/* -loadctl checks of thrashing before suspending */ 
 
-FILE *output = NULL; 	/* PC history for statistical analysis */ 
-FILE *pages = NULL; 	/* block allocation history */ 
-#define MAXPROCESSES 20 /* number of processes in parallel */ 
-#define MAXBRANCHES  40	/* number of branches in a program */ 
-#define MAXEXITS     10	/* number of maximum exits per program */ 
 #define MAXBRINGS   100	/* must be EVEN! data points in branch table */ 
 
-static long sysclock=0; 
-static long seed=0; 
-static long procs=MAXPROCESSES;
+struct simscale simscale = { 
+    DEFAULT_MAXPROCPAGES, DEFAULT_MAXPROCESSES, DEFAULT_PAGESIZE, 
+    DEFAULT_PAGEWAIT, DEFAULT_PHYSICALPAGES 
+}; 
+
+const char *pagerarg = NULL; 
 
 #define LOG_ALWAYS  (1<<0)
 #define LOG_LOAD    (1<<1)
@@ -54,7 +67,7 @@ static long procs=MAXPROCESSES;
 #define CARP(reason) carp((reason),__FILE__,__LINE__)
 
 // always print the result of a test
-inline void check(int boolean, char *boolstr, char *file, int line) { 
+static inline void check(int boolean, char *boolstr, char *file, int line) { 
     if (!boolean) {
         fprintf(stderr,"ERROR: %s failed in line %d of file %s\n",
                 boolstr,line,file);
@@ -65,7 +78,7 @@ inline void check(int boolean, char *boolstr, char *file, int line) {
 }
 
 // die if an assertion fails. 
-inline void assert(int boolean, char *boolstr, char *file, int line) {
+static inline void assert(int boolean, char *boolstr, char *file, int line) {
     if (!boolean) {
         fprintf(stderr,"Assertion %s failed in line %d of file %s\n",
                 boolstr,line,file);
@@ -74,7 +87,7 @@ inline void assert(int boolean, char *boolstr, char *file, int line) {
 }
 
 // report failing assertions without bombing out... keeps running
-inline int posit(int boolean, char *boolstr, char *file, int line) {
+static inline int posit(int boolean, char *boolstr, char *file, int line) {
     if (!boolean) 
         fprintf(stderr,"Assertion %s failed in line %d of file %s\n",
                 boolstr,line,file);
@@ -82,52 +95,19 @@ inline int posit(int boolean, char *boolstr, char *file, int line) {
 }
 
 // die on a fatal error
-inline void die(char *condition, char *file, int line) {
+static inline void die(char *condition, char *file, int line) {
     fprintf(stderr,"Fatal error: %s at line %d of file %s\n", 
         condition,line,file); 
     exit(1); 
 }
 
 // print a non-fatal error 
-inline void carp(char *condition, char *file, int line) {
+static inline void carp(char *condition, char *file, int line) {
     fprintf(stderr,"Non-fatal error: %s at line %d of file %s\n",
 	condition,line,file); 
 }
 
 static long log_port=LOG_ALWAYS;  // logging ports for output
-static void sim_log(long type, const char *format, ...) { 
-    va_list ap; 
-    if (log_port&type) { 
-	va_start(ap, format);
-	fprintf(stderr,"%08ld: ",sysclock); vfprintf(stderr,format,ap); 
-	va_end(ap);
-    } 
-} 
-
-/* keep track of physical page usage */ 
-static long pagesavail = PHYSICALPAGES; 
-
-typedef enum { GOTO, FOR, NFOR, IF } BranchType;
-
-/* abstract description of a branch 
-   describes qualitative behavior, not actual branching */ 
-typedef struct branch { 
-   long wherefrom;
-   long whereto; 
-   BranchType btype; 
-   long min, max; 
-   double prob; 
-   long extent; 
-} Branch;
-
-typedef struct program { 
-   long size; 
-   long nbranches; 
-   Branch branches[MAXBRANCHES]; 
-   long nexits; 
-   long exits[MAXEXITS]; /* which statements are "halt" */ 
-} Program; 
-
 
 // branch context: determines which branch to 
 // take next in a probabilistic situation...
@@ -140,29 +120,325 @@ typedef struct bcontext {
    long brings[MAXBRINGS]; 
 } Bcontext; 
 
+/* state of one page of a slot */ 
+#define PAGE_OUT     0 	/* not in memory */ 
+#define PAGE_IN      1 	/* in memory */ 
+#define PAGE_COMING  2 	/* pagein under way */ 
+#define PAGE_GOING   3 	/* pageout under way; frame not yet free */ 
+
+/* with -dirty, whether a page in memory has to be written to go out */ 
+#define DIRTY_CLEAN   0 
+#define DIRTY_DIRTY   1 
+#define DIRTY_WRITING 2 	/* -writebehind: clean once the write is done */ 
+
+/* a page transfer in flight */ 
+typedef struct transfer { 
+   long due; 			/* tick in which it finishes */ 
+   long slotpage; 		/* slot*MAXPROCPAGES+page */ 
+} Transfer; 
+
+/* the transfers finishing in ticks congruent to one wheel position */ 
+typedef struct bucket { 
+   Transfer *t; 
+   long n, max; 
+} Bucket; 
+
 typedef struct process { 
    Program *program; 
    long nbcontexts; 
-   Bcontext bcontexts[MAXBRANCHES]; 
+   Bcontext *bcontexts; 	/* one per branch of the program */ 
    long pc; 	            	/* program counter */ 
    long npages; 
-   long pages[MAXPROCPAGES]; 	/* whether page is available */ 
-   long blocked[MAXPROCPAGES];	/* whether we've reported page state */ 
+   unsigned char *pages; 	/* PAGE_* state of each page */ 
+   unsigned char *blocked;	/* whether we've reported page state */ 
    long active;              	/* whether running now */ 
    long compute; 	    	/* number of compute ticks */ 
    long block; 		    	/* number of blocked ticks */ 
+   long ready; 			/* runnable ticks spent waiting for a cpu */ 
    long pid; 			/* unique process number */ 
    long kind; 			/* kind of process from table */ 
+   const char *rnext; 		/* -replay: next run of the job's trace */ 
+   const char *rend; 		/* -replay: end of the job's trace */ 
+   long rleft; 			/* -replay: ticks left on the current page */ 
 } Process;
 
-static Process *processes[MAXPROCESSES]; 
+/* Everything one simulation run changes. The simulator and the 
+   pager API (pagein, pageout) act on the run sim points at, which is 
+   per thread, so one program can hold several runs. */ 
+typedef struct simulation { 
+   long sysclock; 
+   long seed; 
+   long procs; 		/* slots in use; all MAXPROCESSES unless -procs */ 
+   Tracefile *trace; 	/* PC and block allocation history */ 
+   const char *reftrace; 	/* where to write the reference trace */ 
+   Replay *replay; 	/* jobs to replay instead of programs.c, or NULL */ 
+   long pagesavail; 	/* physical pages free; threads change it atomically */ 
+
+   /* the pager: a plugin, or pageit() and pageit_events() if ops is NULL */ 
+   const struct pagerops *ops; 
+   void *pstate; 		/* what ops->init() returned */ 
+   struct pagerhost host; 
+   int evented; 		/* pager wants events rather than pageit() */ 
+
+   /* events for pageit_events() since it was last called */ 
+   Pevent *events; 
+   long nevents; 
+   long maxevents; 
+
+   Process **processes; 	/* MAXPROCESSES slots */ 
+
+   /* Page tables live with the slot a process runs in, not with the
+      process, as structure-of-arrays: slot i owns entries 
+      [i*MAXPROCPAGES, (i+1)*MAXPROCPAGES) of each array, so the pages 
+      of all running processes sit together in a few dense blocks. */ 
+   unsigned char *slotpages; 	/* PAGE_* */ 
+   unsigned char *slotblocked; 	/* whether we've reported page state */ 
+   long *slotdue; 	/* tick the page's transfer finishes, if it has one */ 
+   long *slotresident; 	/* what pageit() sees: 1 if in, else 0 */ 
+   Pentry *pentry; 	/* pageit()'s view, pointing at slotresident */ 
+   long *goingout; 	/* pageouts pageit() started this tick */ 
+   long ngoingout; 
+
+   /* transfers in flight, in a timing wheel: a transfer due in tick t 
+      sits in wheel[t&wheelmask], and each tick only its bucket is 
+      looked at. Entries for pages since unloaded are dropped there */ 
+   Bucket *wheel; 
+   long wheelmask; 
+   /* the same transfers in a heap, soonest due first, so allskip() 
+      finds the next one without looking through the wheel. Entries 
+      are dropped once due, or when they reach the top no longer live */ 
+   Transfer *dueheap; 
+   long nheap, maxheap; 
+   long *finished; 	/* slot pages whose transfers finish this tick */ 
+   long maxfinished; 
+
+   /* -swapdev: transfers queue for a swap device rather than all 
+      taking PAGEWAIT ticks; a queued page waits on request slotreq */ 
+   Swapdev *dev; 
+   long *slotreq; 
+
+   /* -dirty: the percentage of its pages a job writes to, -1 if off; 
+      only written pages need writing out. -writebehind writes them 
+      while the device is idle, from slot nextclean on */ 
+   long dirty; 
+   unsigned char *slotdirty; 	/* DIRTY_* */ 
+   long *slotndirty; 	/* per slot: pages DIRTY_DIRTY */ 
+   int writebehind; 
+   long nextclean; 
+   long ndropped; 	/* clean pages paged out without a write */ 
+   long nwritten; 	/* pages written behind */ 
+   int ticks; 		/* -ticks: never skip idle ticks */ 
+
+   /* -cpus: fewer cpus than slots, so runnable processes take turns */ 
+   long cpus; 
+   char *oncpu; 		/* whether each slot has a cpu this tick */ 
+   long nextcpu; 	/* slot to start handing out cpus at */ 
+
+   /* -threads: slots are stepped by several threads, each 
+      slot's output kept aside and written out in slot order */ 
+   long nthreads; 
+   struct worker *workers; 
+   struct slotout *stepout; 	/* per slot: allstep() output */ 
+   char *reload; 		/* per slot: job ended, load the next */ 
+   pthread_barrier_t start; 
+   pthread_barrier_t done; 
+   int stop; 
+
+   /* job queue */ 
+   long queuesize; 	/* jobs to run; -jobs */ 
+   long *queuetype; 
+   Process *queue;
+   long queueend; 
+
+   /* -loadctl: load control, checked every PAGEWAIT ticks */ 
+   int loadctl; 
+   int admit; 		/* refill slots as they empty */ 
+   int pressure; 	/* checks in a row that found thrashing */ 
+   long nextcheck; 	/* tick of the next check */ 
+   long lastwaited; 	/* swap device queued ticks at the last check */ 
+   long lasttransfers; 	/* swap device transfers at the last check */ 
+   long *loadedat; 	/* per slot: tick its process was loaded */ 
+   Process **suspended; /* swapped out whole, oldest first */ 
+   long shead, stail; 
+   long ndeferred; 	/* slot ticks left empty while thrashing */ 
+   long nsuspends; 
+
+   /* -stats: counts per job, and when each slot page was last evicted */ 
+   Stats *stats; 
+   long *slotevicted; 
+
+   /* totals from allscore() */ 
+   long block; 
+   long compute; 
+} Simulation; 
+
+/* what one slot logged, traced and told the pager in a tick */ 
+typedef struct slotout { 
+   char *log; 
+   long nlog, maxlog; 
+   struct tracerec *recs; 
+   long nrecs, maxrecs; 
+   Pevent *events; 
+   long nevents, maxevents; 
+} Slotout; 
+
+/* one -threads thread and the slots it steps */ 
+struct worker { 
+   pthread_t thread; 
+   Simulation *sim; 
+   long first, last; 
+}; 
+
+static __thread Simulation *sim; 
+static __thread Slotout *out; 	/* where slot output goes; NULL: write it */ 
+
+/* make room for one more item in a growing array */ 
+static void *sim_grow(void *p, long n, long *max, size_t size) { 
+    if (n<*max) return p; 
+    *max = *max ? 2**max : 256; 
+    p = realloc(p, *max*size); 
+    if (!p) DIE("out of memory for simulator output"); 
+    return p; 
+} 
+
+static void sim_log(long type, const char *format, ...) { 
+    va_list ap; 
+    char line[256]; 
+    int n; 
+    if (log_port&type) { 
+	va_start(ap, format);
+	if (!out) { 
+	    fprintf(stderr,"%08ld: ",sim->sysclock); vfprintf(stderr,format,ap); 
+	} else { 
+	    n = snprintf(line, sizeof(line), "%08ld: ", sim->sysclock); 
+	    n += vsnprintf(line+n, sizeof(line)-n, format, ap); 
+	    if (n>=(int)sizeof(line)) n = sizeof(line)-1; 
+	    while (out->nlog+n>out->maxlog) 
+		out->log = sim_grow(out->log, out->maxlog, &out->maxlog, 1); 
+	    memcpy(out->log+out->nlog, line, n); 
+	    out->nlog += n; 
+	} 
+	va_end(ap);
+    } 
+} 
+
+static void sim_trace(long slot, long pid, long kind, long value, int event) { 
+    struct tracerec *r; 
+    if (!sim->trace) return; 
+    if (!out) { 
+	if (trace_put(sim->trace, sim->sysclock, slot, pid, kind, value, event) 
+	    !=TRACE_SUCCESS) DIE("could not write event trace"); 
+	return; 
+    } 
+    out->recs = sim_grow(out->recs, out->nrecs, &out->maxrecs, sizeof(*r)); 
+    r = out->recs+out->nrecs++; 
+    r->clock=sim->sysclock; r->slot=slot; r->pid=pid; 
+    r->kind=kind; r->value=value; r->event=event; 
+} 
+
+static void pager_event(int type, int process, int page, int prevpage, 
+			long pc, long kind, long pid) { 
+    Pevent *e; 
+    if (!sim->evented) return; 	/* table-driven pager */ 
+    if (out) { 
+	out->events = sim_grow(out->events, out->nevents, &out->maxevents, 
+			       sizeof(Pevent)); 
+	e = out->events+out->nevents++; 
+    } else { 
+	sim->events = sim_grow(sim->events, sim->nevents, &sim->maxevents, 
+			       sizeof(Pevent)); 
+	e = sim->events+sim->nevents++; 
+    } 
+    e->type=type; e->process=process; e->page=page; 
+    e->prevpage=prevpage; e->pc=pc; e->kind=kind; e->pid=pid; 
+} 
+
+/* write out what a slot did, as if it had been written at the time */ 
+static void slotout_flush(Slotout *o) { 
+    long i; 
+    struct tracerec *r; 
+    Pevent *e; 
+    if (o->nlog) fwrite(o->log, 1, o->nlog, stderr); 
+    for (i=0; i<o->nrecs; i++) { 
+	r = o->recs+i; 
+	if (trace_put(sim->trace, r->clock, r->slot, r->pid, r->kind, r->value, 
+		      r->event)!=TRACE_SUCCESS) DIE("could not write event trace"); 
+    } 
+    for (i=0; i<o->nevents; i++) { 
+	e = o->events+i; 
+	pager_event(e->type, e->process, e->page, e->prevpage, e->pc, e->kind, e->pid); 
+    } 
+    o->nlog = o->nrecs = o->nevents = 0; 
+} 
+
+/* pages freed; any thread may free them */ 
+static void pages_release(long n) { 
+    __atomic_add_fetch(&sim->pagesavail, n, __ATOMIC_RELAXED); 
+} 
+
+/* take a free page if there is one */ 
+static int pages_take() { 
+    long n = __atomic_load_n(&sim->pagesavail, __ATOMIC_RELAXED); 
+    do { 
+	if (n==0) return FALSE; 
+    } while (!__atomic_compare_exchange_n(&sim->pagesavail, &n, n-1, FALSE, 
+					  __ATOMIC_RELAXED, __ATOMIC_RELAXED)); 
+    return TRUE; 
+} 
 
 #include "programs.c" 
 
+/* what jobs run: programs.c unless -workload says otherwise */ 
+static Program *programs = defaultprograms; 
+static long nprograms = PROGRAMS; 
+
+/* Random numbers come from xoshiro256** streams seeded through 
+   splitmix64 with the run seed and a stream number: stream 0 shuffles 
+   the job queue and job pid draws from stream pid+1. What one job 
+   draws depends on no other job, nor on the order jobs are set up */ 
+typedef struct rng { 
+   unsigned long long s[4]; 
+} Rng; 
+
+/* splitmix64: step x and return it mixed */ 
+static unsigned long long rng_mix(unsigned long long *x) { 
+    unsigned long long z = (*x += 0x9E3779B97F4A7C15ULL); 
+    z = (z^(z>>30))*0xBF58476D1CE4E5B9ULL; 
+    z = (z^(z>>27))*0x94D049BB133111EBULL; 
+    return z^(z>>31); 
+} 
+
+static void rng_seed(Rng *r, long seed, long stream) { 
+    unsigned long long x = ((unsigned long long)seed<<32) + (unsigned long long)stream; 
+    int i; 
+    for (i=0; i<4; i++) r->s[i] = rng_mix(&x); 
+} 
+
+#define RNG_ROTL(x,k) (((x)<<(k))|((x)>>(64-(k)))) 
+
+static unsigned long long rng_next(Rng *r) { 
+    unsigned long long *s = r->s; 
+    unsigned long long out = RNG_ROTL(s[1]*5, 7)*9; 
+    unsigned long long t = s[1]<<17; 
+    s[2] ^= s[0]; s[3] ^= s[1]; s[1] ^= s[2]; s[0] ^= s[3]; 
+    s[2] ^= t; s[3] = RNG_ROTL(s[3], 45); 
+    return out; 
+} 
+
+/* uniform in [0,1) */ 
+static double rng_double(Rng *r) { 
+    return (rng_next(r)>>11)*(1.0/9007199254740992.0); 
+} 
+
+/* uniform in [0,n) */ 
+static long rng_below(Rng *r, long n) { 
+    return (long)(rng_next(r)%(unsigned long long)n); 
+} 
+
 /* make a binary decision according to a 
    probability distribution */ 
-static long binary(double prob) { 
-    if (drand48()<prob) return 1; 
+static long binary(Rng *r, double prob) { 
+    if (rng_double(r)<prob) return 1; 
     else return 0; 
 } 
 
@@ -178,7 +454,7 @@ static void bcontext_clear( Bcontext *c) {
 } 
 
 /* initialize a branching engine */ 
-static void bcontext_init( Bcontext *c, Branch *b) { 
+static void bcontext_init( Bcontext *c, Branch *b, Rng *r) { 
     long i; 
     c->bcount=0; 
     c->btype=b->btype; 
@@ -193,15 +469,15 @@ static void bcontext_init( Bcontext *c, Branch *b) {
         long cvalue; 
 	c->boffset=0; 
         c->bsize=0; 
-        cvalue=c->bvalue=binary(b->prob); 
+        cvalue=c->bvalue=binary(r, b->prob); 
         c->bcount=0; 
         // compute future values for if statements 
         while (c->bsize<MAXBRINGS)  {
-	    if (binary(b->prob)==cvalue) { 
+	    if (binary(r, b->prob)==cvalue) { 
 		c->brings[c->bsize]++; 
 	    } else { 
 		c->bsize++; 
-		c->brings[c->bsize]=1; 
+		if (c->bsize<MAXBRINGS) c->brings[c->bsize]=1; 
                 cvalue=!cvalue; 
             } 
 	} 
@@ -211,7 +487,7 @@ static void bcontext_init( Bcontext *c, Branch *b) {
         c->bsize=0; 
         while (c->bsize<MAXBRINGS) { 
 	    if (b->max > b->min) { 
-		c->brings[c->bsize++]=lrand48()%(b->max-b->min)+b->min; 
+		c->brings[c->bsize++]=rng_below(r, b->max-b->min)+b->min; 
             } else { 
 		c->brings[c->bsize++]=b->min; 
             } 
@@ -223,7 +499,7 @@ static void bcontext_init( Bcontext *c, Branch *b) {
         c->bsize=0; 
         while (c->bsize<MAXBRINGS) { 
 	    if (b->max > b->min) { 
-		c->brings[c->bsize++]=lrand48()%(b->max-b->min)+b->min; 
+		c->brings[c->bsize++]=rng_below(r, b->max-b->min)+b->min; 
             } else { 
 		c->brings[c->bsize++]=b->min; 
             } 
@@ -249,55 +525,93 @@ static long bcontext_decide(Bcontext *c) {
 } 
 
 static void process_clear(Process *q) { 
-   long i; 
    q->pc = 0; 
-   q->compute=q->block=0; 
+   q->compute=q->block=q->ready=0; 
    q->program = NULL; 
    q->pid = -1; 
    q->kind = -1;
    q->nbcontexts = 0; 
-   for (i=0; i<MAXBRANCHES; i++) {
-       bcontext_clear(q->bcontexts+i); 
-   } 
+   q->bcontexts = NULL; 
    q->npages = 0; 
-   /* no physical pages assigned */ 
-   for (i=0; i<MAXPROCPAGES; i++) {
-	q->pages[i]=-PAGEWAIT-1; 
-	q->blocked[i]=FALSE; // ALC: so simulator will log first access 
-   } 
+   q->pages = q->blocked = NULL; 	/* no slot yet */ 
+   q->rnext = q->rend = NULL; 
+   q->rleft = 0; 
    q->active=FALSE; 
 } 
 
 /* load a program into a process */ 
 static void process_load(Process *q, Program *p, int pid, int kind) { 
    long i; 
+   Rng r; 
+   rng_seed(&r, sim->seed, pid+1); 
    q->pc = 0; 
-   q->compute=q->block=0; 
+   q->compute=q->block=q->ready=0; 
    q->program = p; 
    q->pid = pid; 
    q->kind = kind; 
    q->nbcontexts = p->nbranches; 
-   ASSERT(p->nbranches>=0 && p->nbranches<MAXBRANCHES); 
+   ASSERT(p->nbranches>=0); 
+   if (p->nbranches) { 
+       q->bcontexts = malloc(p->nbranches*sizeof(Bcontext)); 
+       if (!q->bcontexts) DIE("out of memory for branch contexts"); 
+   } 
    for (i=0; i<p->nbranches; i++) {
-       bcontext_init(q->bcontexts+i, p->branches+i); 
+       bcontext_clear(q->bcontexts+i); 
+       bcontext_init(q->bcontexts+i, p->branches+i, &r); 
    } 
    // fprintf(stderr,"actual page size for process is %d\n", (q->program->size+PAGESIZE-1)/PAGESIZE); 
    q->npages = MAXPROCPAGES; 
+   /* no physical pages assigned */ 
+   q->active=TRUE; 			 /* now running */ 
+} 
+
+/* load a job from the replayed trace into a process; it has no 
+   program, just a run of ticks on each page in turn */ 
+static void process_replay(Process *q, struct replayjob *jb, int pid) { 
+   long page; 
+   q->compute=q->block=q->ready=0; 
+   q->program = NULL; 
+   q->pid = pid; 
+   q->kind = jb->kind; 
+   q->nbcontexts = 0; 
+   q->rnext = jb->start; 
+   q->rend = jb->end; 
+   if (!replay_next(sim->replay, &q->rnext, q->rend, &page, &q->rleft)) 
+	DIE("replayed job has no runs"); 
+   q->pc = page*PAGESIZE; 
+   q->npages = MAXPROCPAGES; 
+   q->active=TRUE; 
+} 
+
+/* run a loaded process in slot pnum, using that slot's page table */ 
+static void process_place(int pnum, Process *q) { 
+   long i; 
+   q->pages = sim->slotpages + pnum*MAXPROCPAGES; 
+   q->blocked = sim->slotblocked + pnum*MAXPROCPAGES; 
    for (i=0; i<MAXPROCPAGES; i++) { 
-	q->pages[i]=-PAGEWAIT-1; 
+	q->pages[i]=PAGE_OUT; 
  	q->blocked[i]=FALSE; // ALC: so simulator will log first access 
+	if (sim->stats) sim->slotevicted[pnum*MAXPROCPAGES+i]=-1; 
+	if (sim->dirty>=0) sim->slotdirty[pnum*MAXPROCPAGES+i]=DIRTY_CLEAN; 
    } 
-   /* no physical pages assigned */ 
-   q->active=TRUE; 			 /* now running */ 
+   if (sim->dirty>=0) sim->slotndirty[pnum]=0; 
+} 
+
+/* -stats counters of a job */ 
+static struct jobstats *process_stats(Process *q) { 
+   return sim->stats->jobs + (q - sim->queue); 
 } 
 
 /* unload a process and release all resources */ 
 static void process_unload(int pnum, Process *q) { 
-   long i; 
+   long i, freed=0; 
    for (i=0; i<q->npages; i++) 
-       if (q->pages[i]>=-PAGEWAIT) { 
-	   pagesavail++; q->pages[i]=-PAGEWAIT-1; q->blocked[i]=1;
+       if (q->pages[i]!=PAGE_OUT) { 
+	   freed++; q->pages[i]=PAGE_OUT; q->blocked[i]=1;
+	   sim->slotresident[pnum*MAXPROCPAGES+i]=FALSE; 
        } 
+   pages_release(freed); 
+   if (sim->dirty>=0) sim->slotndirty[pnum]=0; 
    q->active=FALSE; 
    sim_log(LOG_LOAD,"process %2d; pc %04d: unloaded\n",pnum, q->pc); 
 } 
@@ -306,12 +620,10 @@ static void process_unload(int pnum, Process *q) {
 static void process_dobranch(int pnum, Process *q, Branch *b, Bcontext *c) {
    if (bcontext_decide(c)) { 
 	// must document where we branched from
-       if (output) fprintf(output, "%ld,%d,%ld,%ld,%ld,branch_from\n", 
-		sysclock, pnum, q->pid, q->kind, q->pc); 
+       sim_trace(pnum, q->pid, q->kind, q->pc, TRACE_BRANCH_FROM); 
        q->pc = b->whereto; 
 	// and where we branched to
-       if (output) fprintf(output, "%ld,%d,%ld,%ld,%ld,branch_to\n", 
-		sysclock, pnum, q->pid, q->kind, q->pc); 
+       sim_trace(pnum, q->pid, q->kind, q->pc, TRACE_BRANCH_TO); 
        sim_log(LOG_BRANCH,"process %2d; pc %04d: branch\n",pnum, q->pc); 
    } else { 
        q->pc++; 
@@ -320,13 +632,23 @@ static void process_dobranch(int pnum, Process *q, Branch *b, Bcontext *c) {
    if (q->pc<0 || q->pc>=q->program->size) q->pc=0; /* start over */ 
 } 
 
+/* -dirty: a tick on one of the pages a job writes to dirties it. 
+   Which pages those are is a hash of the job and page, so it does not 
+   depend on the order slots are stepped in */ 
+static void process_write(int pnum, Process *q, long page) { 
+   long sp = pnum*MAXPROCPAGES+page; 
+   unsigned long long x = ((unsigned long long)q->pid<<32) + page; 
+   if (sim->slotdirty[sp]==DIRTY_DIRTY) return; 
+   if ((long)(rng_mix(&x)%100)>=sim->dirty) return; 
+   sim->slotdirty[sp] = DIRTY_DIRTY; 	/* a write under way is stale now */ 
+   sim->slotndirty[pnum]++; 
+} 
+
 /* compute one step of a process */ 
 static long process_step(int pnum, Process *q) { 
    long pc; 
    long page; 
-   long max, min; 
-   Branch *b; 
-   Bcontext *c; 
+   long action; 
 
    if (!q) return FALSE;  
    pc = q->pc; 
@@ -334,144 +656,330 @@ static long process_step(int pnum, Process *q) {
    if (!q->active) { return FALSE; } 
 
    /* if page swapped out, don't allow to run */ 
-   if (q->pages[page]!=0) { 
+   if (q->pages[page]!=PAGE_IN) { 
 	if (!q->blocked[page]) { 
 	    sim_log(LOG_BLOCK,"process=%2d page=%3d blocked\n",pnum,page);
-	    if (output) fprintf(output, "%ld,%d,%ld,%ld,%ld,blocked\n", 
-		sysclock, pnum, q->pid, q->kind, q->pc); 
+	    sim_trace(pnum, q->pid, q->kind, q->pc, TRACE_BLOCKED); 
 	    q->blocked[page]=TRUE; 
+	    pager_event(PAGER_FAULT, pnum, page, page, q->pc, q->kind, q->pid); 
+	    if (sim->stats) 
+		stats_fault(sim->stats, process_stats(q), sim->sysclock, 
+			    sim->slotevicted[pnum*MAXPROCPAGES+page]); 
 	}
 	q->block++; return TRUE; 
    } else { 
 	if (q->blocked[page]) { 
 	    sim_log(LOG_BLOCK,"process=%2d page=%3d unblocked\n",pnum,page);
-	    if (output) fprintf(output, "%ld,%d,%ld,%ld,%ld,unblocked\n",
-		sysclock,pnum, q->pid, q->kind, q->pc);
+	    sim_trace(pnum, q->pid, q->kind, q->pc, TRACE_UNBLOCKED);
 	    q->blocked[page]=FALSE; 
+	    if (sim->stats) stats_resume(process_stats(q), sim->sysclock); 
         } 
 	q->compute++; 
+	if (sim->dirty>=0 && pnum>=0) process_write(pnum,q,page); /* not alltrace() */ 
    }
 
-   /* should I exit */ 
-   ASSERT(q->program->nexits>=0 && q->program->nexits<=MAXEXITS); 
-   min=0; max=q->program->nexits-1; 
-   while (min+1<max) { 
-       long mid=(min+max)/2; 
-       if (pc==q->program->exits[mid]) { 
-	    if (output) fprintf(output, "%ld,%d,%ld,%ld,%ld,exit\n", 
-		sysclock, pnum, q->pid, q->kind, q->pc);
+   if (!q->program) { 
+	/* replayed job: stay on this page until the run is over */ 
+	if (--q->rleft>0) { 
+	    q->pc = page*PAGESIZE + (q->pc+1)%PAGESIZE; 
+	    return TRUE; 
+	} 
+	if (!replay_next(sim->replay, &q->rnext, q->rend, &page, &q->rleft)) { 
+	    sim_trace(pnum, q->pid, q->kind, q->pc, TRACE_EXIT);
 	    return FALSE; 
-       } 
-       else if (pc<q->program->exits[mid])  max=mid; 
-       else                                 min=mid; 
+	} 
+	q->pc = page*PAGESIZE; 
+	return TRUE; 
    } 
-   if (pc==q->program->exits[min] || pc==q->program->exits[max]) { 
-	if (output) fprintf(output, "%ld,%d,%ld,%ld,%ld,exit\n", 
-	    sysclock, pnum, q->pid, q->kind, q->pc);
+
+   /* exit, branch, or just go on: one lookup in the program's table */ 
+   action = q->program->pcaction[pc]; 
+   if (action==PC_EXIT) { 
+	sim_trace(pnum, q->pid, q->kind, q->pc, TRACE_EXIT);
 	return FALSE; 
    } 
-   b = q->program->branches; 
-   c = q->bcontexts; 
-   ASSERT(q->program->nbranches>=0 && q->program->nbranches<=MAXBRANCHES); 
-   min=0; max=q->program->nbranches-1; 
-   while (min+1<max) { 
-       long mid=(min+max)/2; 
-       if (pc==b[mid].wherefrom) {
-	    process_dobranch(pnum,q,b+mid,c+mid);
-	    return TRUE;
-       }
-       else if (pc<b[mid].wherefrom) max=mid; 
-       else                          min=mid; 
+   if (action!=PC_NEXT) { 
+	process_dobranch(pnum,q,q->program->branches+action,q->bcontexts+action); 
+	return TRUE; 
    } 
-   if (pc==b[min].wherefrom) { process_dobranch(pnum,q,b+min,c+min); return TRUE; } 
-   if (pc==b[max].wherefrom) { process_dobranch(pnum,q,b+max,c+max); return TRUE; } 
    q->pc++; /* default action */ 
    if (q->pc<0 || q->pc>q->program->size) { 
-	if (output) fprintf(output, "%ld,%d,%ld,%ld,%ld,out_of_range\n", 
-	    sysclock, pnum, q->pid, q->kind, q->pc);
+	sim_trace(pnum, q->pid, q->kind, q->pc, TRACE_OUT_OF_RANGE);
 	q->pc=0; /* start over */ 
-	if (output) fprintf(output, "%ld,%d,%ld,%ld,%ld,restart\n", 
-	    sysclock, pnum, q->pid, q->kind, q->pc);
+	sim_trace(pnum, q->pid, q->kind, q->pc, TRACE_RESTART);
    } 
    return TRUE; 
 } 
    
 
-/* public routine: swap one page out */ 
-int pageout(int process, int page) { 
-    if (process<0 || process>=procs 
-     || !processes[process]
-     || !processes[process]->active
-     || page<0 || page>=processes[process]->npages) 
+/* add a transfer to the due heap */ 
+static void dueheap_push(long slotpage, long due) { 
+    Transfer *h; 
+    long i = sim->nheap++, up; 
+    sim->dueheap = sim_grow(sim->dueheap, i, &sim->maxheap, sizeof(Transfer)); 
+    h = sim->dueheap; 
+    for (; i>0 && h[up=(i-1)/2].due>due; i=up) h[i] = h[up]; 
+    h[i].due = due; 
+    h[i].slotpage = slotpage; 
+} 
+
+/* drop the soonest transfer from the due heap */ 
+static void dueheap_pop() { 
+    Transfer *h = sim->dueheap, last = h[--sim->nheap]; 
+    long i=0, c; 
+    while ((c=2*i+1)<sim->nheap) { 
+	if (c+1<sim->nheap && h[c+1].due<h[c].due) c++; 
+	if (h[c].due>=last.due) break; 
+	h[i] = h[c]; 
+	i = c; 
+    } 
+    h[i] = last; 
+} 
+
+/* note a transfer that has started and finishes in tick due */ 
+static void transfer_start(long slotpage, long due) { 
+    Bucket *b; 
+    dueheap_push(slotpage, due); 
+    sim->slotdue[slotpage] = due; 
+    b = sim->wheel + (due & sim->wheelmask); 
+    if (b->n==b->max) { 
+	b->max = b->max ? 2*b->max : 16; 
+	b->t = realloc(b->t, b->max*sizeof(Transfer)); 
+	if (!b->t) DIE("out of memory for transfers"); 
+    } 
+    b->t[b->n].due = due; 
+    b->t[b->n].slotpage = slotpage; 
+    b->n++; 
+} 
+
+/* a transfer of count pages from slotpage on: without a swap device 
+   they start now and finish PAGEWAIT ticks later, else they wait 
+   their turn as one request */ 
+static void transfer_request(long slotpage, long count) { 
+    long i, id; 
+    if (!sim->dev) { 
+	for (i=0; i<count; i++) transfer_start(slotpage+i, sim->sysclock+PAGEWAIT); 
+	return; 
+    } 
+    id = swapdev_submit(sim->dev, slotpage, count, sim->sysclock); 
+    for (i=0; i<count; i++) { 
+	sim->slotdue[slotpage+i] = -1; 
+	sim->slotreq[slotpage+i] = id; 
+    } 
+} 
+
+/* whether a page is in a transfer: coming, going, or written back */ 
+static int transfer_page(long slotpage) { 
+    long state = sim->slotpages[slotpage]; 
+    return state==PAGE_COMING || state==PAGE_GOING 
+	|| (state==PAGE_IN && sim->dirty>=0 && sim->slotdirty[slotpage]==DIRTY_WRITING); 
+} 
+
+/* whether a queued request is still the one its page is waiting on */ 
+static int transfer_wanted(long slotpage, long id) { 
+    Process *q = sim->processes[slotpage/MAXPROCPAGES]; 
+    return q && q->active && transfer_page(slotpage) 
+	&& sim->slotdue[slotpage]<0 && sim->slotreq[slotpage]==id; 
+} 
+
+/* whether a wheel entry is still the transfer its page is waiting on */ 
+static int transfer_live(Transfer *t) { 
+    Process *q = sim->processes[t->slotpage/MAXPROCPAGES]; 
+    return q && q->active && transfer_page(t->slotpage) 
+	&& sim->slotdue[t->slotpage]==t->due; 
+} 
+
+/* tick in which the next transfer finishes, -1 if none is in flight */ 
+static long transfer_next() { 
+    while (sim->nheap && (sim->dueheap[0].due<sim->sysclock 
+			  || !transfer_live(sim->dueheap))) 
+	dueheap_pop(); 
+    return sim->nheap ? sim->dueheap[0].due : -1; 
+} 
+
+/* start paging out one page; TRUE as pageout() would return. A dirty 
+   page is left in *write for the caller to write, a clean one drops */ 
+static int page_out(int process, int page, int *write) { 
+    long sp = process*MAXPROCPAGES+page; 
+    *write = FALSE; 
+    if (process<0 || process>=sim->procs 
+     || !sim->processes[process]
+     || !sim->processes[process]->active
+     || page<0 || page>=sim->processes[process]->npages) 
 	return FALSE; 
-    if (processes[process]->pages[page]<0) 
+    if (sim->processes[process]->pages[page]==PAGE_GOING 
+     || sim->processes[process]->pages[page]==PAGE_OUT) 
 	return TRUE; /* on its way out */ 
-    if (processes[process]->pages[page]>0) 
+    if (sim->processes[process]->pages[page]==PAGE_COMING) 
 	return FALSE; /* not available to swap out */ 
 sim_log(LOG_PAGE,"process=%2d page=%3d start pageout\n",process,page);
-    if (pages) fprintf(pages,"%ld,%d,%d,%ld,%ld,going\n",
-	sysclock,process,page,processes[process]->pid, processes[process]->kind); 
-    processes[process]->pages[page]=-1; return TRUE;
+    sim_trace(process, 
+	sim->processes[process]->pid, sim->processes[process]->kind, page, TRACE_GOING); 
+    sim->processes[process]->pages[page]=PAGE_GOING; 
+    if (sim->dirty<0 || sim->slotdirty[sp]!=DIRTY_CLEAN) { 
+	if (sim->dirty>=0 && sim->slotdirty[sp]==DIRTY_DIRTY) sim->slotndirty[process]--; 
+	if (sim->dirty>=0) sim->slotdirty[sp]=DIRTY_CLEAN; 
+	*write = TRUE; 
+    } else { 
+	transfer_start(sp, sim->sysclock+1); 	/* nothing to write */ 
+	sim->ndropped++; 
+    } 
+    if (sim->stats) { 
+	process_stats(sim->processes[process])->evictions++; 
+	sim->slotevicted[sp]=sim->sysclock; 
+    } 
+    /* pageit() sees a snapshot: clear the page once it returns */ 
+    sim->goingout[sim->ngoingout++]=sp; return TRUE;
 } 
 
-/* public routine: swap one page in */ 
-int pagein(int process, int page) { 
-    if (process<0 || process>=procs 
-     || !processes[process]
-     || !processes[process]->active
-     || page<0 || page>=processes[process]->npages)
+/* start paging in one page; TRUE as pagein() would return, and *read 
+   if the page has to be read */ 
+static int page_in(int process, int page, int *read) { 
+    *read = FALSE; 
+    if (process<0 || process>=sim->procs 
+     || !sim->processes[process]
+     || !sim->processes[process]->active
+     || page<0 || page>=sim->processes[process]->npages)
 	return FALSE; 
-    if (processes[process]->pages[page]>=0) 
+    if (sim->processes[process]->pages[page]==PAGE_IN 
+     || sim->processes[process]->pages[page]==PAGE_COMING) 
 	return TRUE; /* on its way */ 
-    if (pagesavail==0) 
-	return FALSE; 
-    if (processes[process]->pages[page]>=-PAGEWAIT ) 
+    if (sim->processes[process]->pages[page]==PAGE_GOING) 
 	return FALSE; /* not yet out */ 
+    if (!pages_take()) 
+	return FALSE; 
     sim_log(LOG_PAGE,"process=%2d page=%3d start pagein\n",process,page);
-    if (pages) fprintf(pages,"%ld,%d,%d,%ld,%ld,coming\n",
-	sysclock,process,page,processes[process]->pid, processes[process]->kind); 
-    processes[process]->pages[page]=PAGEWAIT; pagesavail--; return TRUE; 
+    sim_trace(process, 
+	sim->processes[process]->pid, sim->processes[process]->kind, page, TRACE_COMING); 
+    sim->processes[process]->pages[page]=PAGE_COMING; 
+    if (sim->stats) process_stats(sim->processes[process])->pageins++; 
+    *read = TRUE; return TRUE; 
+} 
+
+/* do page_in() or page_out() for npages pages from page on, until one 
+   fails, and transfer each run of pages to read or write at once */ 
+static int page_range(int (*one)(int, int, int *), int process, int page, 
+		      int npages) { 
+    int n, move, first=0, run=0; 
+    for (n=0; n<npages; n++) { 
+	if (!one(process, page+n, &move)) break; 
+	if (move && run++==0) first = page+n; 
+	if (!move && run) { 
+	    transfer_request(process*MAXPROCPAGES+first, run); 
+	    run = 0; 
+	} 
+    } 
+    if (run) transfer_request(process*MAXPROCPAGES+first, run); 
+    return n; 
+} 
+
+/* public routine: swap one page out */ 
+int pageout(int process, int page) { 
+    return page_range(page_out, process, page, 1); 
+} 
+
+/* public routine: swap one page in */ 
+int pagein(int process, int page) { 
+    return page_range(page_in, process, page, 1); 
+} 
+
+/* public routine: swap a run of pages out */ 
+int pageout_range(int process, int page, int npages) { 
+    return page_range(page_out, process, page, npages); 
+} 
+
+/* public routine: swap a run of pages in */ 
+int pagein_range(int process, int page, int npages) { 
+    return page_range(page_in, process, page, npages); 
+} 
+
+/* public routine: whether paging a page out needs a write */ 
+int pagedirty(int process, int page) { 
+    if (process<0 || process>=sim->procs 
+     || !sim->processes[process]
+     || !sim->processes[process]->active
+     || page<0 || page>=sim->processes[process]->npages) 
+	return FALSE; 
+    return sim->dirty<0 
+	|| sim->slotdirty[process*MAXPROCPAGES+page]!=DIRTY_CLEAN; 
 } 
 
 /*============
    job queue
   ============*/ 
 
-#define QUEUESIZE (PROGRAMS*8)
-static long queuetype[QUEUESIZE]; 
-static Process queue[QUEUESIZE];
-static long queueend; 
+#define QUEUESIZE (sim->queuesize) 
+
+
 static void initqueue() { 
-   long i,repeats; 
-   for (i=0; i<QUEUESIZE; i++) queuetype[i]=i%PROGRAMS; 
-   // for (i=0; i<QUEUESIZE; i++) queuetype[i]=lrand48()%PROGRAMS; 
+   long i,k,repeats,total=0; 
+   long *credit; 
+   Rng r; 
+   if (sim->replay) { 	/* jobs run in the order of the trace */ 
+       for (i=0; i<QUEUESIZE; i++) { 
+	   process_clear(sim->queue+i); 
+	   process_replay(sim->queue+i, sim->replay->jobs+i, i); 
+       } 
+       sim->queueend=0; 
+       return; 
+   } 
+   /* deal out kinds in proportion to their weights, evenly spread: 
+      equal weights give 0,1,2,...,0,1,2,... as they always have */ 
+   credit = malloc(nprograms*sizeof(long)); 
+   if (!credit) DIE("out of memory for job queue"); 
+   for (k=0; k<nprograms; k++) { credit[k]=0; total+=programs[k].weight; } 
+   for (i=0; i<QUEUESIZE; i++) { 
+       long best=0; 
+       for (k=0; k<nprograms; k++) { 
+	   credit[k]+=programs[k].weight; 
+	   if (credit[k]>credit[best]) best=k; 
+       } 
+       credit[best]-=total; 
+       sim->queuetype[i]=best; 
+   } 
+   free(credit); 
+   rng_seed(&r, sim->seed, 0); 
    for (repeats=0; repeats<10; repeats++) 
        for (i=0; i<QUEUESIZE; i++) { 
-	  int j=lrand48()%QUEUESIZE;
-	  long temp=queuetype[i]; queuetype[i]=queuetype[j]; queuetype[j]=temp; 
+	  int j=rng_below(&r, QUEUESIZE);
+	  long temp=sim->queuetype[i]; sim->queuetype[i]=sim->queuetype[j]; sim->queuetype[j]=temp; 
        } 
    for (i=0; i<QUEUESIZE; i++) { 
-        process_clear(queue+i); 
-	process_load(queue+i,programs+queuetype[i], i, queuetype[i]); 
+        process_clear(sim->queue+i); 
+	process_load(sim->queue+i,programs+sim->queuetype[i], i, sim->queuetype[i]); 
    } 
-   queueend=0; 
+   sim->queueend=0; 
 } 
 static Process * dequeue() { 
-   if (queueend<QUEUESIZE) return queue+queueend++; 
+   if (sim->queueend<QUEUESIZE) return sim->queue+sim->queueend++; 
    else return NULL; 
 } 
-static long empty() { return queueend>=QUEUESIZE; } 
+static long empty() { return sim->queueend>=QUEUESIZE; } 
 
 /*===========================
    control of all processes 
   ===========================*/ 
 
+/* one page for allprint(): in, out, or ticks left to come in or go out 
+   (q while still queued for the swap device) */ 
+static void allprint_page(long i, long j, char mark) { 
+    long sp = i*MAXPROCPAGES+j; 
+    long left = sim->slotdue[sp]-sim->sysclock; 
+    if ((sim->slotpages[sp]==PAGE_COMING || sim->slotpages[sp]==PAGE_GOING) 
+     && sim->slotdue[sp]<0) 
+	fprintf(stderr,"%c%c  q",mark,sim->slotpages[sp]==PAGE_COMING ? 'i' : 'o'); 
+    else if (sim->slotpages[sp]==PAGE_COMING) fprintf(stderr,"%ci%3ld",mark,left); 
+    else if (sim->slotpages[sp]==PAGE_IN) fprintf(stderr,"%c=in ",mark); 
+    else if (sim->slotpages[sp]==PAGE_OUT) fprintf(stderr,"%c=out",mark); 
+    else fprintf(stderr,"%co%3ld",mark,left); 
+} 
+
 static void allprint() { 
     int i,j; 
     fprintf(stderr,"\nprocess  "); 
     for (i=0; i<MAXPROCESSES/2; i++) { 
 	if (i) fprintf(stderr," | "); 
-	if (processes[i] && processes[i]->active) { 
+	if (sim->processes[i] && sim->processes[i]->active) { 
 	    fprintf(stderr,"  %02d",i); 
         } else { 
 	    fprintf(stderr,"  --"); 
@@ -481,8 +989,8 @@ static void allprint() {
     fprintf(stderr,"pc       "); 
     for (i=0; i<MAXPROCESSES/2; i++) { 
 	if (i) fprintf(stderr," | "); 
-	if (processes[i] && processes[i]->active) { 
-	    fprintf(stderr,"%04ld",processes[i]->pc); 
+	if (sim->processes[i] && sim->processes[i]->active) { 
+	    fprintf(stderr,"%04ld",sim->processes[i]->pc); 
         } else { 
 	    fprintf(stderr,"----"); 
         }
@@ -492,28 +1000,12 @@ static void allprint() {
 	fprintf(stderr,"page%02d  ",j); 
 	for (i=0; i<MAXPROCESSES/2; i++) { 
 	    if (i) fprintf(stderr," |"); 
-	    if (processes[i] && processes[i]->active) { 
-		int pcblock =  processes[i]->pc/PAGESIZE; 
+	    if (sim->processes[i] && sim->processes[i]->active) { 
+		int pcblock =  sim->processes[i]->pc/PAGESIZE; 
 		if (j==pcblock) { 
-		    if (processes[i]->pages[j]>0) 
-			fprintf(stderr,"*i%3ld",processes[i]->pages[j]); 
-		    else if (processes[i]->pages[j]==0) 
-			fprintf(stderr,"*=in "); 
-		    else if (processes[i]->pages[j]==-100) 
-			fprintf(stderr,"*=out"); 
-		    else 
-			fprintf(stderr,"*o%3ld",100+processes[i]->pages[j]); 
-		    // fprintf(stderr,"*%4d",processes[i]->pages[j]); 
+		    allprint_page(i,j,'*'); 
 	  	} else { 
-		    if (processes[i]->pages[j]>0) 
-			fprintf(stderr," i%3ld",processes[i]->pages[j]); 
-		    else if (processes[i]->pages[j]==0) 
-			fprintf(stderr," =in "); 
-		    else if (processes[i]->pages[j]==-100) 
-			fprintf(stderr," =out"); 
-		    else 
-			fprintf(stderr," o%3ld",100+processes[i]->pages[j]); 
-		    // fprintf(stderr," %4d",processes[i]->pages[j]); 
+		    allprint_page(i,j,' '); 
 		} 
 	    } else { 
 		fprintf(stderr," ----"); 
@@ -525,7 +1017,7 @@ static void allprint() {
     fprintf(stderr,"process  "); 
     for (i=MAXPROCESSES/2; i<MAXPROCESSES; i++) {
 	if (i-MAXPROCESSES/2) fprintf(stderr," | "); 
-	if (processes[i] && processes[i]->active) { 
+	if (sim->processes[i] && sim->processes[i]->active) { 
 	    fprintf(stderr,"  %02d",i); 
         } else { 
 	    fprintf(stderr,"  --"); 
@@ -535,8 +1027,8 @@ static void allprint() {
     fprintf(stderr,"pc       "); 
     for (i=MAXPROCESSES/2; i<MAXPROCESSES; i++) {
 	if (i-MAXPROCESSES/2) fprintf(stderr," | "); 
-	if (processes[i] && processes[i]->active) { 
-	    fprintf(stderr,"%04ld",processes[i]->pc); 
+	if (sim->processes[i] && sim->processes[i]->active) { 
+	    fprintf(stderr,"%04ld",sim->processes[i]->pc); 
         } else { 
 	    fprintf(stderr,"----"); 
         }
@@ -546,28 +1038,12 @@ static void allprint() {
 	fprintf(stderr,"page%02d  ",j); 
 	for (i=MAXPROCESSES/2; i<MAXPROCESSES; i++) {
 	    if (i-MAXPROCESSES/2) fprintf(stderr," |"); 
-	    if (processes[i] && processes[i]->active) { 
-		int pcblock =  processes[i]->pc/PAGESIZE; 
+	    if (sim->processes[i] && sim->processes[i]->active) { 
+		int pcblock =  sim->processes[i]->pc/PAGESIZE; 
 		if (j==pcblock) { 
-		    if (processes[i]->pages[j]>0) 
-			fprintf(stderr,"*i%3ld",processes[i]->pages[j]); 
-		    else if (processes[i]->pages[j]==0) 
-			fprintf(stderr,"*=in "); 
-		    else if (processes[i]->pages[j]==-100) 
-			fprintf(stderr,"*=out"); 
-		    else 
-			fprintf(stderr,"*o%3ld",100+processes[i]->pages[j]); 
-		    // fprintf(stderr,"*%4d",processes[i]->pages[j]); 
+		    allprint_page(i,j,'*'); 
 	  	} else {
-		    if (processes[i]->pages[j]>0) 
-			fprintf(stderr," i%3ld",processes[i]->pages[j]); 
-		    else if (processes[i]->pages[j]==0) 
-			fprintf(stderr," =in "); 
-		    else if (processes[i]->pages[j]==-100) 
-			fprintf(stderr," =out"); 
-		    else 
-			fprintf(stderr," o%3ld",100+processes[i]->pages[j]); 
-		    // fprintf(stderr," %4d",processes[i]->pages[j]); 
+		    allprint_page(i,j,' '); 
 		} 
 	    } else { 
 		fprintf(stderr," ----"); 
@@ -578,79 +1054,254 @@ static void allprint() {
     fprintf(stderr,"----------------------------------------------------------------------------\n"); 
 } 
 
-static void endit() { allprint(); exit(0); } 
+static void endit() { if (sim) allprint(); exit(0); } 
   
+/* write the page reference trace of every job, one line per run of 
+   ticks a job spends on one page. Jobs never see the pager, so the 
+   trace is the same whichever pager runs; it is worked out before 
+   the run by stepping a copy of each job with every page resident. */ 
+static void alltrace(FILE *f) { 
+    long i, page, ticks; 
+    long oldport = log_port; 
+    Tracefile *oldtrace = sim->trace; 
+    unsigned char *resident = calloc(2*MAXPROCPAGES, sizeof(unsigned char)); 
+    Process q; 
+    if (!resident) DIE("out of memory for reference trace"); 
+    memset(resident, PAGE_IN, MAXPROCPAGES); 
+    log_port = 0; sim->trace = NULL; /* keep the dry run out of the logs */ 
+    fprintf(f, "# pid kind page ticks\n"); 
+    for (i=0; i<QUEUESIZE; i++) { 
+	q = sim->queue[i]; 
+	q.bcontexts = NULL; 
+	if (q.nbcontexts) { 	/* the job itself must start from scratch */ 
+	    q.bcontexts = malloc(q.nbcontexts*sizeof(Bcontext)); 
+	    if (!q.bcontexts) DIE("out of memory for reference trace"); 
+	    memcpy(q.bcontexts, sim->queue[i].bcontexts, 
+		q.nbcontexts*sizeof(Bcontext)); 
+	} 
+	q.pages = resident; 
+	q.blocked = resident+MAXPROCPAGES; 
+	page = q.pc/PAGESIZE; 
+	ticks = 1; 
+	while (process_step(-1, &q)) { 
+	    if (q.pc/PAGESIZE != page) { 
+		fprintf(f, "%ld %ld %ld %ld\n", q.pid, q.kind, page, ticks); 
+		page = q.pc/PAGESIZE; 
+		ticks = 0; 
+	    } 
+	    ticks++; 
+	} 
+	fprintf(f, "%ld %ld %ld %ld\n", q.pid, q.kind, page, ticks); 
+	free(q.bcontexts); 
+    } 
+    log_port = oldport; 
+    sim->trace = oldtrace; 
+    free(resident); 
+} 
+
+/* put the next job, if there is one, in empty slot i; with -loadctl, 
+   a suspended process goes back in before any new job, and nothing 
+   does while memory is overcommitted */ 
+static void load_slot(long i) { 
+    Process *q; 
+    if (sim->loadctl && !sim->admit) { 
+	if (sim->shead<sim->stail || !empty()) sim->ndeferred++; 
+	return; 
+    } 
+    if (sim->loadctl && sim->shead<sim->stail) { 
+	q = sim->suspended[sim->shead++ % QUEUESIZE]; 
+	q->active = TRUE; 
+    } else if (empty()) { 
+	return; 
+    } else { 
+	q = dequeue(); 
+    } 
+    sim->processes[i] = q; 
+    process_place(i, q); 
+    if (sim->loadctl) sim->loadedat[i] = sim->sysclock; 
+    sim_log(LOG_LOAD,"process %2d; pc %04d: loaded\n",i, q->pc); 
+    sim_trace(i, q->pid, q->kind, q->pc, TRACE_LOAD); 
+    pager_event(PAGER_LOAD, i, 0, 0, q->pc, q->kind, q->pid); 
+} 
+
 static void allinit () { 
     long i; 
-    initqueue(); 
-    for (i=0; i<MAXPROCESSES; i++) processes[i]=NULL; 
-    for (i=0; i<procs; i++) { 
+    for (i=0; i<MAXPROCESSES; i++) sim->processes[i]=NULL; 
+    for (i=0; i<sim->procs; i++) { 
 	// zero out pages from processes
-	if (!empty()) {
-	    processes[i]=dequeue(); 
-
-	    sim_log(LOG_LOAD,"process %2d; pc %04d: loaded\n",i, processes[i]->pc); 
-	    if (output) fprintf(output, "%ld,%ld,%ld,%ld,%ld,load\n", 
-		sysclock, i, processes[i]->pid, 
-		processes[i]->kind, processes[i]->pc);
-	    if (pages) { 
-		long j;
-		for (j=0; j<MAXPROCPAGES; j++) 
-		    fprintf(pages,"%ld,%ld,%ld,%ld,%ld,out\n",
-			sysclock,i,j,processes[i]->pid,processes[i]->kind); 
-	    } 
+	load_slot(i); 
+	if (sim->processes[i] && sim->trace) { 
+	    long j;
+	    for (j=0; j<MAXPROCPAGES; j++) 
+		sim_trace(i, sim->processes[i]->pid, sim->processes[i]->kind, 
+		    j, TRACE_OUT); 
 	} 
     } 
 } 
 
 static void allscore() { 
-    int i; 
-    int block=0; 
-    int compute=0; 
+    long i; 
+    long block=0; 
+    long compute=0; 
+    long ready=0; 
     for (i=0; i<QUEUESIZE; i++) { 
-	block+=queue[i].block; 
-	compute+=queue[i].compute; 
+	block+=sim->queue[i].block; 
+	compute+=sim->queue[i].compute; 
+	ready+=sim->queue[i].ready; 
     } 
     sim_log(LOG_ALWAYS, "simulation ends\n"); 
-    sim_log(LOG_ALWAYS, "%d blocked cycles\n",block); 
-    sim_log(LOG_ALWAYS, "%d compute cycles\n",compute); 
+    sim_log(LOG_ALWAYS, "%ld blocked cycles\n",block); 
+    sim_log(LOG_ALWAYS, "%ld compute cycles\n",compute); 
+    if (sim->oncpu) sim_log(LOG_ALWAYS, "%ld ready cycles\n",ready); 
+    if (sim->loadctl) sim_log(LOG_ALWAYS, "%ld slot ticks held empty, %ld processes suspended\n", 
+			      sim->ndeferred, sim->nsuspends); 
+    if (sim->dirty>=0) sim_log(LOG_ALWAYS, "%ld clean pages dropped, %ld pages written behind\n", 
+			       sim->ndropped, sim->nwritten); 
+    if (sim->dev) sim_log(LOG_ALWAYS, "%ld transfers of %ld pages, %ld sequential, %g ticks queued on average, at most %ld queued\n", 
+			  sim->dev->transfers, sim->dev->pages, sim->dev->sequentials, 
+			  sim->dev->transfers ? (double)sim->dev->waited/sim->dev->transfers : 0.0, 
+			  sim->dev->longest); 
     sim_log(LOG_ALWAYS, "ratio blocked/compute=%g\n",(double)block/(double)compute); 
+    sim->block=block; 
+    sim->compute=compute; 
+    for (i=0; i<QUEUESIZE && sim->stats; i++) { 
+	sim->stats->jobs[i].pid=sim->queue[i].pid; 
+	sim->stats->jobs[i].kind=sim->queue[i].kind; 
+	sim->stats->jobs[i].compute=sim->queue[i].compute; 
+	sim->stats->jobs[i].block=sim->queue[i].block; 
+    } 
+} 
 
+/* with -cpus, hand the cpus out to runnable processes for this tick, 
+   round robin from the slot after the last one to get a cpu */ 
+static void allschedule() { 
+    long i,n,page,last=-1,free=sim->cpus; 
+    Process *q; 
+    if (!sim->oncpu) return; 
+    for (n=0; n<sim->procs; n++) { 
+	i = (sim->nextcpu+n)%sim->procs; 
+	q = sim->processes[i]; 
+	page = q ? q->pc/PAGESIZE : 0; 
+	sim->oncpu[i] = FALSE; 
+	if (free>0 && q && q->active && q->pages[page]==PAGE_IN) { 
+	    sim->oncpu[i] = TRUE; 
+	    free--; 
+	    last = i; 
+	} 
+    } 
+    if (last>=0) sim->nextcpu = (last+1)%sim->procs; 
+} 
+
+/* step the process in slot i; TRUE if the slot is left empty */ 
+static int step_slot(long i) { 
+    Process *q = sim->processes[i]; 
+    long page = q ? q->pc/PAGESIZE : 0; 
+    if (q && sim->oncpu && !sim->oncpu[i] && q->active && q->pages[page]==PAGE_IN) { 
+	q->ready++; 	/* could run, but every cpu is taken */ 
+	return FALSE; 
+    } 
+    if (process_step(i,q)) { 
+	if (q->pc/PAGESIZE != page) 
+	    pager_event(PAGER_PCPAGE, i, q->pc/PAGESIZE, page, q->pc, q->kind, q->pid); 
+	return FALSE; 
+    } 
+    if (q && q->active) { 
+	// document final PC position 
+	sim_trace(i, q->pid, q->kind, q->pc, TRACE_UNLOAD); 
+	if (sim->trace) { 
+	    long j;
+	    for (j=0; j<MAXPROCPAGES; j++) 
+		sim_trace(i, q->pid, q->kind, j, TRACE_OUT); 
+	} 
+	process_unload(i,q); 
+	pager_event(PAGER_UNLOAD, i, 0, 0, q->pc, q->kind, q->pid); 
+    } 
+    sim->processes[i]=NULL; 
+    return TRUE; 
+} 
+
+/* swap the process in slot i out whole; it goes back in where it 
+   left off once memory pressure lets up */ 
+static void suspend_slot(long i) { 
+    Process *q = sim->processes[i]; 
+    long j; 
+    sim_log(LOG_LOAD,"process %2d; pc %04d: suspended\n",i, q->pc); 
+    sim_trace(i, q->pid, q->kind, q->pc, TRACE_UNLOAD); 
+    for (j=0; j<MAXPROCPAGES && sim->trace; j++) 
+	sim_trace(i, q->pid, q->kind, j, TRACE_OUT); 
+    process_unload(i,q); 
+    pager_event(PAGER_UNLOAD, i, 0, 0, q->pc, q->kind, q->pid); 
+    sim->suspended[sim->stail++ % QUEUESIZE] = q; 
+    sim->processes[i] = NULL; 
+    sim->nsuspends++; 
+} 
+
+/* -loadctl: every PAGEWAIT ticks, count the running processes blocked 
+   on a page. Memory is overcommitted if most of them are, and paging 
+   is what holds them up: with -swapdev, transfers started since the 
+   last check queued longer than a transfer takes on average (or none 
+   started while some queued); without, fewer frames are free than 
+   processes run. Then leave slots empty as processes finish, and if 
+   that goes on for LOADCTL_PATIENCE checks, suspend the process loaded 
+   last. Once it lets up, put back one process per check. A suspended 
+   process loses all of its frames, so suspending early costs more than 
+   it saves */ 
+static void allloadctl() { 
+    long i, n, running=0, blocked=0, newest=-1, slot=-1, nempty=0; 
+    int paging; 
+    Process *q; 
+    if (!sim->loadctl || sim->sysclock<sim->nextcheck) return; 
+    sim->nextcheck = sim->sysclock+PAGEWAIT; 
+    for (i=0; i<sim->procs; i++) { 
+	q = sim->processes[i]; 
+	if (q && q->active) { 
+	    running++; 
+	    if (q->pages[q->pc/PAGESIZE]!=PAGE_IN) blocked++; 
+	    if (newest<0 || sim->loadedat[i]>=sim->loadedat[newest]) newest=i; 
+	} else if (!q) { 
+	    if (slot<0) slot=i; 
+	    nempty++; 
+	} 
+    } 
+    if (sim->dev) { 
+	n = sim->dev->transfers-sim->lasttransfers; 
+	paging = n ? sim->dev->waited-sim->lastwaited > n*PAGEWAIT 
+		   : sim->dev->nqueue>0; 
+	sim->lasttransfers = sim->dev->transfers; 
+	sim->lastwaited = sim->dev->waited; 
+    } else { 
+	paging = sim->pagesavail<running; 
+    } 
+    if (running>1 && 2*blocked>running && paging) { 
+	sim->admit = FALSE; 
+	if (++sim->pressure>=LOADCTL_PATIENCE) { 
+	    suspend_slot(newest); 
+	    sim->pressure = 0; 
+	} 
+	return; 
+    } 
+    sim->pressure = 0; 
+    if (slot<0) { 
+	sim->admit = TRUE; 
+	return; 
+    } 
+    sim->admit = TRUE; 
+    load_slot(slot); 
+    sim->admit = nempty<=1; 	/* refill the rest one check at a time */ 
 } 
 
 static void allstep () { 
     long i; 
-    for (i=0; i<procs; i++) { 
-	if (!process_step(i,processes[i])) { 
-	    if (processes[i] && processes[i]->active) { 
-		// document final PC position 
-		if (output) fprintf(output, "%ld,%ld,%ld,%ld,%ld,unload\n", 
-		    sysclock, i, processes[i]->pid, 
-		    processes[i]->kind, processes[i]->pc);
-		if (pages) { 
-		    long j;
-		    for (j=0; j<MAXPROCPAGES; j++) 
-			fprintf(pages,"%ld,%ld,%ld,%ld,%ld,out\n",
-			    sysclock,i,j,processes[i]->pid, processes[i]->kind); 
-		} 
-		process_unload(i,processes[i]); 
-	    } 
-	    processes[i]=NULL; 
-            if (!empty()) {
-		processes[i]=dequeue();
-	        sim_log(LOG_LOAD,"process %2d; pc %04d: loaded\n",i, processes[i]->pc); 
-		if (output) fprintf(output, "%ld,%ld,%ld,%ld,%ld,load\n", 
-		    sysclock, i, processes[i]->pid, 
-		    processes[i]->kind, processes[i]->pc);
-	    } 
-	} 
+    for (i=0; i<sim->procs; i++) { 
+	if (step_slot(i)) load_slot(i); 
     } 
 } 
 
 static long alldone () { 
     long i; 
-    for (i=0; i<procs; i++) { 
-	if (processes[i] && processes[i]->active) return FALSE; 
+    if (sim->loadctl && (sim->shead<sim->stail || !empty())) return FALSE; 
+    for (i=0; i<sim->procs; i++) { 
+	if (sim->processes[i] && sim->processes[i]->active) return FALSE; 
     } 
     return TRUE; 
 } 
@@ -661,12 +1312,12 @@ static int allblocked() {
     int memwait=0; 
     int freewait=0; 
     int i,stat; 
-    for (i=0; i<procs; i++) 
-	if (processes[i] && processes[i]->active) { 
-	    stat=processes[i]->pages[(int)(processes[i]->pc/PAGESIZE)]; 
-	    if (stat>0) memwait++;	/* waiting for swap in */ 
-	    else if (stat==0) runnable++; /* ok */ 
-	    else if (stat<-PAGEWAIT) allfree++; /* free */
+    for (i=0; i<sim->procs; i++) 
+	if (sim->processes[i] && sim->processes[i]->active) { 
+	    stat=sim->processes[i]->pages[(int)(sim->processes[i]->pc/PAGESIZE)]; 
+	    if (stat==PAGE_COMING) memwait++;	/* waiting for swap in */ 
+	    else if (stat==PAGE_IN) runnable++; /* ok */ 
+	    else if (stat==PAGE_OUT) allfree++; /* free */
 	    else freewait++; /* waiting for swap out */ 
 	} 
 
@@ -683,61 +1334,408 @@ static int allblocked() {
     } 
 } 
 
+/* If every process is blocked and has already faulted, nothing can 
+   happen until a transfer finishes: the ticks until then would only 
+   count blocked ticks and age pages, and an event-driven pager is not 
+   called on them. Do all of that at once and jump the clock to the 
+   tick the transfer finishes in. Only event-driven pagers skip: a 
+   pageit() pager is called every tick and may count those calls as 
+   time (the classic LRU stub stamps pages with a tick counter of its 
+   own), so leaving calls out would change what it does; it always 
+   runs tick by tick. The saving is in runs that block for long 
+   stretches, a few slots and a long -pagewait; at the default scale 
+   some process can nearly always run and little is skipped. */ 
+static void allskip() { 
+    long i,k,due,page; 
+    Process *q; 
+    if (!sim->evented || sim->ticks || (log_port&LOG_DEAD)) return; 
+    for (i=0; i<sim->procs; i++) { 
+	q = sim->processes[i]; 
+	if (!q || !q->active) continue; 
+	page = q->pc/PAGESIZE; 
+	if (q->pages[page]==PAGE_IN || !q->blocked[page]) return; 
+    } 
+    due = transfer_next(); 
+    if (sim->dev) { 	/* or a queued one can start */ 
+	k = swapdev_next(sim->dev); 
+	if (k>=0 && (due<0 || k<due)) due = k; 
+    } 
+    if (sim->writebehind && swapdev_next(sim->dev)<0) { 
+	/* or dirty pages can be written behind */ 
+	for (i=0; i<sim->procs && !sim->slotndirty[i]; i++) ; 
+	k = swapdev_ready(sim->dev); 
+	if (i<sim->procs && (due<0 || k<due)) due = k; 
+    } 
+    if (due<0) return; 	/* deadlocked; allblocked() will say so */ 
+    if (sim->loadctl && sim->nextcheck<due) due = sim->nextcheck; 
+    k = due-sim->sysclock; 
+    if (k<=0) return; 
+    for (i=0; i<sim->procs; i++) { 
+	q = sim->processes[i]; 
+	if (!q && sim->loadctl && !sim->admit 
+	 && (sim->shead<sim->stail || !empty())) sim->ndeferred += k; 
+	if (!q || !q->active) continue; 
+	q->block += k; 
+    } 
+    if (sim->stats) 
+	stats_frames(sim->stats, sim->sysclock, PHYSICALPAGES-sim->pagesavail, k); 
+    sim->sysclock += k; 
+} 
+
+static int byslotpage(const void *a, const void *b) { 
+    long x = *(const long *)a, y = *(const long *)b; 
+    return (x>y)-(x<y); 
+} 
+
+/* finish the transfers due this tick. Only their bucket is looked 
+   at; they are finished in slot and page order, as when every page 
+   of every process was counted down each tick */ 
 static void allage () { 
-   long i; 
-   for (i=0; i<procs; i++) { 
-       if (processes[i] && processes[i]->active) { 
-    	   long j; 	
-	   for (j=0; j<processes[i]->npages; j++) {
-                if (processes[i]->pages[j]==0) ; 
-                else if (processes[i]->pages[j]<-PAGEWAIT) ; 
-		else if (processes[i]->pages[j]>0) { 
-		    processes[i]->pages[j]--; 
-		    if (processes[i]->pages[j]==0) { 
-			sim_log(LOG_PAGE,"process=%2d page=%3d end   pagein\n",i,j);
-			if (pages) fprintf(pages,"%ld,%ld,%ld,%ld,%ld,in\n",
-			    sysclock,i,j,processes[i]->pid, processes[i]->kind); 
-		    } 
-		} else if (processes[i]->pages[j]<0 
-                       && processes[i]->pages[j]>=-PAGEWAIT) {
-		    processes[i]->pages[j]--; 
-		    if(processes[i]->pages[j]<-PAGEWAIT) { 
-			sim_log(LOG_PAGE,"process=%2d page=%3d end   pageout\n",i,j);
-			if (pages) fprintf(pages,"%ld,%ld,%ld,%ld,%ld,out\n",
-			    sysclock,i,j,processes[i]->pid, processes[i]->kind); 
-			pagesavail++; 
-		    } 
-                } 
+    Bucket *b = sim->wheel + (sim->sysclock & sim->wheelmask); 
+    Process *q; 
+    long i, j, n=0, keep=0, sp; 
+    for (i=0; i<b->n; i++) { 
+	if (b->t[i].due<sim->sysclock || !transfer_live(b->t+i)) continue; 
+	if (b->t[i].due>sim->sysclock) { b->t[keep++] = b->t[i]; continue; } 
+	sim->finished = sim_grow(sim->finished, n, &sim->maxfinished, sizeof(long)); 
+	sim->finished[n++] = b->t[i].slotpage; 
+    } 
+    b->n = keep; 
+    while (sim->nheap && sim->dueheap[0].due<=sim->sysclock) dueheap_pop(); 
+    if (n>1) qsort(sim->finished, n, sizeof(long), byslotpage); 
+    for (i=0; i<n; i++) { 
+	sp = sim->finished[i]; 
+	j = sp%MAXPROCPAGES; 
+	q = sim->processes[sp/MAXPROCPAGES]; 
+	if (sim->slotpages[sp]==PAGE_COMING) { 
+	    sim->slotpages[sp] = PAGE_IN; 
+	    sim_log(LOG_PAGE,"process=%2d page=%3d end   pagein\n",sp/MAXPROCPAGES,j);
+	    sim->slotresident[sp]=TRUE; 
+	    sim_trace(sp/MAXPROCPAGES, q->pid, q->kind, j, TRACE_IN); 
+	    pager_event(PAGER_PAGEIN_DONE, sp/MAXPROCPAGES, j, j, q->pc, q->kind, q->pid); 
+	} else if (sim->slotpages[sp]==PAGE_IN) { 
+	    sim->slotdirty[sp] = DIRTY_CLEAN; 
+	    sim_log(LOG_PAGE,"process=%2d page=%3d end   writeback\n",sp/MAXPROCPAGES,j);
+	} else { 
+	    sim->slotpages[sp] = PAGE_OUT; 
+	    sim_log(LOG_PAGE,"process=%2d page=%3d end   pageout\n",sp/MAXPROCPAGES,j);
+	    sim_trace(sp/MAXPROCPAGES, q->pid, q->kind, j, TRACE_OUT); 
+	    pages_release(1); 
+	    pager_event(PAGER_PAGEOUT_DONE, sp/MAXPROCPAGES, j, j, q->pc, q->kind, q->pid); 
+	} 
+    } 
+} 
+
+/* -writebehind: while the swap device has a channel free and nothing 
+   queued, write dirty pages back, a run at a time, so that paging them 
+   out later costs nothing. The page under a pc is left alone; it would 
+   only be written again. Slots take turns at going first */ 
+static void allclean() { 
+    long n, i, j, k, sp, pcpage; 
+    Process *q; 
+    if (!sim->writebehind) return; 
+    for (n=0; n<sim->procs; n++) { 
+	i = (sim->nextclean+n)%sim->procs; 
+	q = sim->processes[i]; 
+	if (!q || !q->active || !sim->slotndirty[i]) continue; 
+	pcpage = q->pc/PAGESIZE; 
+	for (j=0; j<MAXPROCPAGES; j++) { 
+	    if (swapdev_next(sim->dev)>=0 || swapdev_ready(sim->dev)>sim->sysclock) { 
+		sim->nextclean = i; 
+		return; 
 	    } 
+	    sp = i*MAXPROCPAGES+j; 
+	    for (k=0; j+k<MAXPROCPAGES && j+k!=pcpage 
+		     && sim->slotdirty[sp+k]==DIRTY_DIRTY; k++) { 
+		sim_log(LOG_PAGE,"process=%2ld page=%3ld start writeback\n",i,j+k);
+		sim->slotdirty[sp+k] = DIRTY_WRITING; 
+	    } 
+	    if (k==0) continue; 
+	    sim->slotndirty[i] -= k; 
+	    sim->nwritten += k; 
+	    transfer_request(sp, k); 
+	    swapdev_start(sim->dev, sim->sysclock, transfer_wanted, transfer_start); 
+	    j += k; 
 	} 
-   } 
+    } 
+} 
+
+/* one thread's share of a tick: step slots first to last. The output 
+   is kept aside here and written in slot order by allmerge() */ 
+static void work_slots(long first, long last) { 
+    long i; 
+    for (i=first; i<last; i++) { 
+	out = sim->stepout+i; 
+	sim->reload[i] = step_slot(i); 
+    } 
+    out = NULL; 
+} 
+
+/* write out every slot's output, and load new jobs, in slot order */ 
+static void allmerge() { 
+    long i; 
+    for (i=0; i<sim->procs; i++) { 
+	slotout_flush(sim->stepout+i); 
+	if (sim->reload[i]) load_slot(i); 
+    } 
+} 
+
+static void *worker_main(void *arg) { 
+    struct worker *w = arg; 
+    sim = w->sim; 
+    for (;;) { 
+	pthread_barrier_wait(&sim->start); 
+	if (sim->stop) break; 
+	work_slots(w->first, w->last); 
+	pthread_barrier_wait(&sim->done); 
+    } 
+    return NULL; 
+} 
+
+/* allstep() on every thread, worker 0 being this one */ 
+static void allwork() { 
+    pthread_barrier_wait(&sim->start); 
+    work_slots(sim->workers[0].first, sim->workers[0].last); 
+    pthread_barrier_wait(&sim->done); 
+    allmerge(); 
+} 
+
+static void workers_start() { 
+    long i; 
+    sim->workers = calloc(sim->nthreads, sizeof(struct worker)); 
+    sim->stepout = calloc(sim->procs, sizeof(Slotout)); 
+    sim->reload = calloc(sim->procs, sizeof(char)); 
+    if (!sim->workers || !sim->stepout || !sim->reload) 
+	DIE("out of memory for threads"); 
+    pthread_barrier_init(&sim->start, NULL, sim->nthreads); 
+    pthread_barrier_init(&sim->done, NULL, sim->nthreads); 
+    for (i=0; i<sim->nthreads; i++) { 
+	sim->workers[i].sim = sim; 
+	sim->workers[i].first = sim->procs*i/sim->nthreads; 
+	sim->workers[i].last = sim->procs*(i+1)/sim->nthreads; 
+	if (i>0 && pthread_create(&sim->workers[i].thread, NULL, 
+				  worker_main, sim->workers+i)!=0) 
+	    DIE("could not start thread"); 
+    } 
+} 
+
+static void workers_stop() { 
+    long i; 
+    sim->stop = TRUE; 
+    pthread_barrier_wait(&sim->start); 
+    for (i=1; i<sim->nthreads; i++) pthread_join(sim->workers[i].thread, NULL); 
+    pthread_barrier_destroy(&sim->start); 
+    pthread_barrier_destroy(&sim->done); 
+    for (i=0; i<sim->procs; i++) { 
+	free(sim->stepout[i].log); free(sim->stepout[i].recs); 
+	free(sim->stepout[i].events); 
+    } 
+    free(sim->stepout); 
+    free(sim->reload); 
+    free(sim->workers); 
 } 
 
 static void callyou() { 
-    long i,j; 
-    Pentry pentry[MAXPROCESSES];
-    for (i=0; i<MAXPROCESSES; i++) { 
-	if (processes[i]) { 
-	    pentry[i].active=processes[i]->active; 
-	    pentry[i].pc=processes[i]->pc; 
-	    pentry[i].npages = processes[i]->npages; 
-	    for (j=0; j<processes[i]->npages; j++) {
-		pentry[i].pages[j]=(processes[i]->pages[j]==0); 
+    long i; 
+    if (sim->evented) { 	/* only what changed, only when it did */ 
+	if (sim->nevents && sim->ops) 
+	    sim->ops->events(sim->pstate, sim->events, sim->nevents, sim->sysclock); 
+	else if (sim->nevents) 
+	    pageit_events(sim->events, sim->nevents, sim->sysclock); 
+	sim->nevents = 0; 
+    } else { 
+	for (i=0; i<MAXPROCESSES; i++) { 
+	    /* pentry[i].pages already tracks the slot's pages */ 
+	    if (sim->processes[i]) { 
+		sim->pentry[i].active=sim->processes[i]->active; 
+		sim->pentry[i].pc=sim->processes[i]->pc; 
+		sim->pentry[i].npages = sim->processes[i]->npages; 
+	    } else { 
+		sim->pentry[i].active=FALSE; 
+		sim->pentry[i].pc=0; 
+		sim->pentry[i].npages = 0; 
 	    } 
-	    for (; j<MAXPROCPAGES; j++) pentry[i].pages[j]=FALSE; 
-        } else { 
-	    pentry[i].active=FALSE; 
-	    pentry[i].pc=0; 
-	    pentry[i].npages = 0; 
-	    for (j=0; j<MAXPROCPAGES; j++) pentry[i].pages[j]=FALSE; 
-        } 
+	} 
+	if (sim->ops) sim->ops->pageit(sim->pstate, sim->pentry); 
+	else pageit(sim->pentry); 	/* call your routine */ 
     } 
-    pageit(pentry); 	/* call your routine */ 
+    for (i=0; i<sim->ngoingout; i++) sim->slotresident[sim->goingout[i]]=FALSE; 
+    sim->ngoingout=0; 
+} 
+
+/* make a new run, sizing all per-slot and per-job storage from simscale */ 
+static Simulation *sim_new(long seed, long procs, long jobs, long cpus, 
+			   long threads) { 
+    long i; 
+    Simulation *s = calloc(1, sizeof(Simulation)); 
+    if (!s) DIE("out of memory for simulation"); 
+    s->seed = seed; 
+    s->procs = procs; 
+    s->queuesize = jobs; 
+    s->dirty = -1; 
+    s->pagesavail = PHYSICALPAGES; 
+    s->processes = calloc(MAXPROCESSES, sizeof(Process *)); 
+    s->slotpages = calloc(MAXPROCESSES*MAXPROCPAGES, sizeof(unsigned char)); 
+    s->slotblocked = calloc(MAXPROCESSES*MAXPROCPAGES, sizeof(unsigned char)); 
+    s->slotdue = malloc(MAXPROCESSES*MAXPROCPAGES*sizeof(long)); 
+    s->slotresident = calloc(MAXPROCESSES*MAXPROCPAGES, sizeof(long)); 
+    s->pentry = calloc(MAXPROCESSES, sizeof(Pentry)); 
+    s->goingout = malloc(MAXPROCESSES*MAXPROCPAGES*sizeof(long)); 
+    s->queuetype = malloc(jobs*sizeof(long)); 
+    s->queue = malloc(jobs*sizeof(Process)); 
+    /* one turn of the wheel covers a whole transfer */ 
+    for (s->wheelmask=1; s->wheelmask<=PAGEWAIT; s->wheelmask*=2) ; 
+    s->wheel = calloc(s->wheelmask, sizeof(Bucket)); 
+    s->wheelmask--; 
+    s->cpus = cpus; 
+    s->nthreads = threads<procs ? threads : procs; 
+    if (cpus<procs) { 
+	s->oncpu = calloc(procs, sizeof(char)); 
+	if (!s->oncpu) DIE("out of memory for cpus"); 
+    } 
+    if (!s->processes || !s->slotpages || !s->slotblocked || !s->slotresident 
+     || !s->slotdue || !s->wheel || !s->pentry || !s->goingout || !s->queuetype || !s->queue) 
+	DIE("out of memory for simulator tables"); 
+    for (i=0; i<MAXPROCESSES; i++) 
+	s->pentry[i].pages = s->slotresident + i*MAXPROCPAGES; 
+    return s; 
+} 
+
+/* release a run; trace files belong to the caller */ 
+static void sim_free(Simulation *s) { 
+    long i; 
+    for (i=0; i<s->queuesize; i++) free(s->queue[i].bcontexts); 
+    free(s->events); 
+    free(s->processes); 
+    free(s->slotpages); 
+    free(s->slotblocked); 
+    free(s->slotresident); 
+    free(s->pentry); 
+    free(s->goingout); 
+    for (i=0; i<=s->wheelmask; i++) free(s->wheel[i].t); 
+    free(s->wheel); 
+    free(s->dueheap); 
+    free(s->finished); 
+    free(s->slotdue); 
+    free(s->slotreq); 
+    free(s->slotdirty); 
+    free(s->slotndirty); 
+    if (s->dev) swapdev_free(s->dev); 
+    free(s->oncpu); 
+    free(s->slotevicted); 
+    free(s->loadedat); 
+    free(s->suspended); 
+    if (s->stats) stats_free(s->stats); 
+    free(s->queuetype); 
+    free(s->queue); 
+    free(s); 
+} 
+
+/* run the current simulation until every job has finished */ 
+static void sim_run() { 
+    initqueue(); 
+    if (sim->reftrace) { 	/* before the pager starts, so it can read it */ 
+	FILE *f = fopen(sim->reftrace, "w"); 
+	if (!f) DIE("could not open reference trace for writing"); 
+	alltrace(f); 
+	fclose(f); 
+    } 
+    if (sim->ops) { 
+	sim->host.scale = simscale; 
+	sim->host.arg = pagerarg; 
+	sim->host.pagein = pagein; 
+	sim->host.pageout = pageout; 
+	sim->host.pagein_range = pagein_range; 
+	sim->host.pageout_range = pageout_range; 
+	sim->host.dirty = pagedirty; 
+	sim->evented = sim->ops->events!=NULL; 
+	sim->pstate = sim->ops->init(&sim->host); 
+    } else { 
+	if (!pageit && !pageit_events) 
+	    DIE("pager defines neither pageit nor pageit_events"); 
+	sim->evented = pageit_events!=NULL; 
+    } 
+    allinit(); 
+    if (sim->nthreads>1) workers_start(); 
+    while (!alldone()) { // all processes inactive
+	allskip(); 	 // jump over ticks where nothing can happen 
+	allloadctl(); 	 // with -loadctl, hold back jobs while thrashing 
+	allschedule(); 	 // give out the cpus, if there are fewer than slots 
+	if (sim->nthreads>1) allwork(); // allstep() on several threads 
+	else allstep(); 	 // advance time one tick; if process done, reload
+	allage(); 	 // finish the page transfers due this tick 
+
+        callyou(); 	 // call your program
+	if (sim->dev) 	 // start what the swap device has room for 
+	    swapdev_start(sim->dev, sim->sysclock, transfer_wanted, transfer_start); 
+	allclean(); 	 // with -writebehind, write dirty pages if it is idle 
+	if (sim->stats) 	 // frames in use by the end of the tick 
+	    stats_frames(sim->stats, sim->sysclock, PHYSICALPAGES-sim->pagesavail, 1); 
+	sim->sysclock++; // remember new time. 
+	allblocked();    // deadlock detection 
+    } 
+    if (sim->nthreads>1) workers_stop(); 
+    allscore(); 
+    if (sim->ops) sim->ops->fini(sim->pstate); 
+} 
+
+/* load a pager plugin built as a shared object */ 
+static const struct pagerops *pager_open(const char *path) { 
+    char local[1024]; 
+    void *lib; 
+    const struct pagerops *ops; 
+    /* a bare name would be looked for on the library path */ 
+    if (!strchr(path,'/')) { 
+	snprintf(local, sizeof(local), "./%s", path); 
+	path = local; 
+    } 
+    lib = dlopen(path, RTLD_NOW|RTLD_LOCAL); 
+    if (!lib) { 
+	fprintf(stderr, "%s\n", dlerror()); 
+	return NULL; 
+    } 
+    ops = dlsym(lib, "pager_plugin"); 
+    if (!ops || ops->abi!=PAGER_ABI || !ops->init || !ops->fini 
+     || (!ops->events && !ops->pageit)) { 
+	fprintf(stderr, "%s: no pager_plugin for pager ABI %d\n", path, PAGER_ABI); 
+	dlclose(lib); 
+	return NULL; 
+    } 
+    return ops; 
+} 
+
+/* read a positive size for a scale option */ 
+static int getscale(char *prog, char *opt, char *arg, long *value) { 
+    if (!arg || sscanf(arg,"%ld",value)!=1 || *value<1) { 
+	fprintf(stderr, "%s: %s needs a positive number\n", prog, opt); 
+	return 1; 
+    } 
+    return 0; 
 } 
 
 int main(int argc, char **argv) { 
     
     long i,errors=0,help=0; 
+    long seed=0,procs=0,jobs=0; 
+    FILE *output=NULL,*pages=NULL,*in=NULL; 
+    const char *reftrace=NULL,*tracepath=NULL,*replaypath=NULL; 
+    const char *workload=NULL; 
+    int ticks=FALSE; 
+    long cpus=0,threads=1; 
+    const struct pagerops *ops[MAXPAGERS]; 
+    long block[MAXPAGERS],compute[MAXPAGERS]; 
+    long npagers=0,p; 
+    const char *statspath=NULL; 
+    FILE *statsfile=NULL; 
+    long refault=0; 
+    int loadctl=FALSE; 
+    const char *swappolicy=NULL; 
+    long swapchan=1,swapseq=0,swapbw=0; 
+    long dirty=-1; 
+    int writebehind=FALSE; 
+    Replay *replay=NULL; 
+    Tracefile *trace=NULL; 
+    pid_t gzip=0; 
  
     signal(SIGINT, endit); 
     
@@ -784,23 +1782,146 @@ int main(int argc, char **argv) {
 			argv[0]); 
 		errors++; 
 	    } 
+	} else if (strcmp(argv[i],"-trace")==0 && i+1<argc) { 
+	    tracepath = argv[++i]; 
+	} else if (strcmp(argv[i],"-cpus")==0) { 
+	    errors += getscale(argv[0], argv[i], argv[i+1], &cpus); i++; 
+	} else if (strcmp(argv[i],"-threads")==0) { 
+	    errors += getscale(argv[0], argv[i], argv[i+1], &threads); i++; 
+	} else if (strcmp(argv[i],"-stats")==0 && i+1<argc) { 
+	    statspath = argv[++i]; 
+	} else if (strcmp(argv[i],"-refault")==0) { 
+	    errors += getscale(argv[0], argv[i], argv[i+1], &refault); i++; 
+	} else if (strcmp(argv[i],"-loadctl")==0) { 
+	    loadctl = TRUE; 
+	} else if (strcmp(argv[i],"-swapdev")==0 && i+1<argc) { 
+	    swappolicy = argv[++i]; 
+	} else if (strcmp(argv[i],"-swapchan")==0) { 
+	    errors += getscale(argv[0], argv[i], argv[i+1], &swapchan); i++; 
+	} else if (strcmp(argv[i],"-swapseq")==0) { 
+	    errors += getscale(argv[0], argv[i], argv[i+1], &swapseq); i++; 
+	} else if (strcmp(argv[i],"-swapbw")==0) { 
+	    errors += getscale(argv[0], argv[i], argv[i+1], &swapbw); i++; 
+	} else if (strcmp(argv[i],"-dirty")==0) { 
+	    if (i+1>=argc || sscanf(argv[++i],"%ld",&dirty)!=1 || dirty<0 || dirty>100) { 
+		fprintf(stderr, "%s: -dirty needs a percentage\n", argv[0]); 
+		errors++; 
+	    } 
+	} else if (strcmp(argv[i],"-writebehind")==0) { 
+	    writebehind = TRUE; 
+	} else if (strcmp(argv[i],"-ticks")==0) { 
+	    ticks = TRUE; 
+	} else if (strcmp(argv[i],"-workload")==0 && i+1<argc) { 
+	    workload = argv[++i]; 
+	} else if (strcmp(argv[i],"-replay")==0 && i+1<argc) { 
+	    replaypath = argv[++i]; 
+	} else if (strcmp(argv[i],"-reftrace")==0 && i+1<argc) { 
+	    reftrace = argv[++i]; 
+	} else if (strcmp(argv[i],"-pager")==0 && i+1<argc) { 
+	    if (npagers==MAXPAGERS) { 
+		fprintf(stderr, "%s: at most %d pagers\n", argv[0], MAXPAGERS); 
+		errors++; i++; 
+	    } else if (!(ops[npagers]=pager_open(argv[++i]))) errors++; 
+	    else npagers++; 
+	} else if (strcmp(argv[i],"-pagerarg")==0 && i+1<argc) { 
+	    pagerarg = argv[++i]; 
 	} else if (strcmp(argv[i],"-procs")==0) { 
 	    if (sscanf(argv[++i],"%ld",&procs)!=1) {
 		fprintf(stderr,
 			"%s: could not read number of processors from command line\n",
 			argv[0]); 
 		errors++; 
-	    } else if (procs<1 || procs>MAXPROCESSES) {
-		fprintf(stderr,
-			"%s: number of processors must be between 1 and %d\n",
-			argv[0], MAXPROCESSES); 
-		errors++; 
 	    } 
+	} else if (strcmp(argv[i],"-maxprocs")==0) { 
+	    errors += getscale(argv[0], argv[i], argv[i+1], &simscale.maxprocesses); i++; 
+	} else if (strcmp(argv[i],"-pages")==0) { 
+	    errors += getscale(argv[0], argv[i], argv[i+1], &simscale.maxprocpages); i++; 
+	} else if (strcmp(argv[i],"-pagesize")==0) { 
+	    errors += getscale(argv[0], argv[i], argv[i+1], &simscale.pagesize); i++; 
+	} else if (strcmp(argv[i],"-pagewait")==0) { 
+	    errors += getscale(argv[0], argv[i], argv[i+1], &simscale.pagewait); i++; 
+	} else if (strcmp(argv[i],"-physical")==0) { 
+	    errors += getscale(argv[0], argv[i], argv[i+1], &simscale.physicalpages); i++; 
+	} else if (strcmp(argv[i],"-jobs")==0) { 
+	    errors += getscale(argv[0], argv[i], argv[i+1], &jobs); i++; 
         } else { 
 	    fprintf(stderr, "t4: unrecognized argument %s\n", argv[i]); 
 	    errors++; 
  	} 
     } 
+    if (procs==0) procs=MAXPROCESSES; 
+    if (procs<1 || procs>MAXPROCESSES) {
+	fprintf(stderr,
+		"%s: number of processors must be between 1 and %ld\n",
+		argv[0], MAXPROCESSES); 
+	errors++; 
+    } 
+    if (replaypath) { 
+	replay = replay_open(replaypath, MAXPROCPAGES); 
+	if (!replay) errors++; 
+	else if (jobs==0 || jobs>replay->njobs) jobs = replay->njobs; 
+    } 
+    if (workload) { 
+	nprograms = workload_load(workload, &programs); 
+	if (nprograms>=0) workload_compile(programs, nprograms); 
+	if (nprograms<0) { 
+	    programs = defaultprograms; 
+	    nprograms = PROGRAMS; 
+	    errors++; 
+	} else if (nprograms>REPLAY_MAXKIND+1) { 
+	    fprintf(stderr, "%s: a workload can have at most %d programs\n", 
+		    argv[0], REPLAY_MAXKIND+1); 
+	    errors++; 
+	} 
+    } 
+    if (programs==defaultprograms) workload_compile(programs, nprograms); 
+    if (jobs==0) jobs=nprograms*8; 
+    for (i=0; i<nprograms && !replaypath; i++) { 
+	if (programs[i].size>=MAXPC) { 
+	    fprintf(stderr,
+		    "%s: program %ld needs more than %ld pages of %ld\n",
+		    argv[0], i, MAXPROCPAGES, PAGESIZE); 
+	    errors++; 
+	} 
+    } 
+    if (npagers>1 && (output || tracepath)) { 
+	fprintf(stderr, "%s: -csv and -trace take only one pager\n", argv[0]); 
+	errors++; 
+    } 
+    if (statspath) { 
+	statsfile = fopen(statspath, "w"); 
+	if (!statsfile) { 
+	    fprintf(stderr, "%s: could not open %s for writing\n", 
+		    argv[0], statspath); 
+	    errors++; 
+	} 
+    } 
+    if (refault==0) refault=10*PAGEWAIT; 
+    if (swapseq==0) swapseq = PAGEWAIT>=10 ? PAGEWAIT/10 : 1; 
+    if (swappolicy && strcmp(swappolicy,"fifo") && strcmp(swappolicy,"elevator")) { 
+	fprintf(stderr, "%s: -swapdev is fifo or elevator\n", argv[0]); 
+	errors++; 
+    } 
+    if (writebehind && (!swappolicy || dirty<0)) { 
+	fprintf(stderr, "%s: -writebehind needs -swapdev and -dirty\n", argv[0]); 
+	errors++; 
+    } 
+    /* events are always traced in binary; -csv converts them at the end */ 
+    if (tracepath) { 
+	trace = trace_create(tracepath); 
+	if (!trace) { 
+	    fprintf(stderr, "%s: could not open %s for writing\n", 
+		    argv[0], tracepath); 
+	    errors++; 
+	} 
+    } else if (output && pages) { 
+	in = tmpfile(); 
+	trace = in ? trace_wrap(in) : NULL; 
+	if (!trace) { 
+	    fprintf(stderr, "%s: could not make a temporary trace\n", argv[0]); 
+	    errors++; 
+	} 
+    } 
     if (errors || help) { 
 	fprintf(stderr, "%s usage: %s \n", argv[0], argv[0]); 
         fprintf(stderr, "  -all       log everything\n"); 
@@ -812,6 +1933,31 @@ int main(int argc, char **argv) {
 	fprintf(stderr, "  -procs 4   run only four processors\n"); 
 	fprintf(stderr, "  -dead      detect deadlocks\n"); 
 	fprintf(stderr, "  -csv       generate output.csv and pages.csv for graphing\n");
+	fprintf(stderr, "  -trace f       write a binary event trace to f (.gz compresses)\n"); 
+	fprintf(stderr, "  -cpus 4        simulate 4 cpus shared by the slots (default one each)\n"); 
+	fprintf(stderr, "  -threads 4     step slots on 4 threads; worth it for thousands of slots\n"); 
+	fprintf(stderr, "  -stats f       write fault, latency and frame statistics to f as JSON\n"); 
+	fprintf(stderr, "  -refault 1000  count faults within 1000 ticks of eviction (default 10 pagewaits)\n"); 
+	fprintf(stderr, "  -loadctl       hold back and suspend processes while memory is overcommitted\n"); 
+	fprintf(stderr, "  -swapdev fifo  queue transfers for a swap device, fifo or elevator order\n"); 
+	fprintf(stderr, "  -swapchan 1    transfers the swap device runs at once (default 1)\n"); 
+	fprintf(stderr, "  -swapseq 10    ticks to swap the page after the last one (default pagewait/10)\n"); 
+	fprintf(stderr, "  -swapbw 4      swap at most 4 pages per pagewait (default no limit)\n"); 
+	fprintf(stderr, "  -dirty 30      jobs write to 30%% of their pages; only those are written out\n"); 
+	fprintf(stderr, "  -writebehind   write dirty pages back while the swap device is idle\n"); 
+	fprintf(stderr, "  -ticks         step every tick, even when nothing can run\n"); 
+	fprintf(stderr, "                 (only event-driven pagers skip idle ticks; pageit() runs every tick)\n"); 
+	fprintf(stderr, "  -workload f    run the programs described in f\n"); 
+	fprintf(stderr, "  -replay f      run the jobs of page reference trace f\n"); 
+	fprintf(stderr, "  -reftrace f    write every job's page reference trace to f\n"); 
+	fprintf(stderr, "  -pager p.so    run plugin p.so; repeat to compare pagers on the same jobs\n"); 
+	fprintf(stderr, "  -pagerarg a    pass a to the pager as pagerarg\n"); 
+	fprintf(stderr, "  -maxprocs 20   process slots (default %d)\n", DEFAULT_MAXPROCESSES); 
+	fprintf(stderr, "  -pages 20      pages per process (default %d)\n", DEFAULT_MAXPROCPAGES); 
+	fprintf(stderr, "  -pagesize 128  size of a page (default %d)\n", DEFAULT_PAGESIZE); 
+	fprintf(stderr, "  -pagewait 100  ticks to swap a page (default %d)\n", DEFAULT_PAGEWAIT); 
+	fprintf(stderr, "  -physical 100  physical pages (default %d)\n", DEFAULT_PHYSICALPAGES); 
+	fprintf(stderr, "  -jobs 40       processes to run in all (default %ld, or all replayed)\n", nprograms*8); 
 	if(errors) {
 	    return EXIT_FAILURE;
 	}
@@ -822,19 +1968,86 @@ int main(int argc, char **argv) {
     if (seed==0) { 
 	seed = (time(NULL)*38491+71831+time(NULL)*time(NULL))&((1<<30)-1); 
     } 
-    srand48(seed); 
-    sim_log(LOG_ALWAYS,"random seed %d\n", seed); 
-    sim_log(LOG_ALWAYS,"using %d processors\n", procs); 
-    
-    allinit(); 
-    while (!alldone()) { // all processes inactive
-	allstep(); 	 // advance time one tick; if process done, reload
-        allage(); 	 // advance time for page wait variables. 
-        callyou(); 	 // call your program
-	sysclock++;      // remember new time. 
-	allblocked();    // deadlock detection 
+    if (cpus==0 || cpus>procs) cpus=procs; 
+    if (npagers==0) ops[npagers++] = &pager_plugin; 	/* NULL if not a plugin */ 
+    for (p=0; p<npagers; p++) { 
+	/* every pager gets the same jobs: they draw from streams of seed */ 
+	sim = sim_new(seed, procs, jobs, cpus, threads); 
+	sim->ops = ops[p]; 
+	sim->trace = trace; 
+	sim->reftrace = reftrace; 
+	sim->replay = replay; 
+	sim->ticks = ticks; 
+	if (loadctl) { 
+	    sim->loadctl = TRUE; 
+	    sim->admit = TRUE; 
+	    sim->loadedat = calloc(MAXPROCESSES, sizeof(long)); 
+	    sim->suspended = malloc(jobs*sizeof(Process *)); 
+	    if (!sim->loadedat || !sim->suspended) DIE("out of memory for load control"); 
+	} 
+	if (swappolicy) { 
+	    sim->dev = swapdev_new(swappolicy, swapchan, PAGEWAIT, swapseq, swapbw, PAGEWAIT); 
+	    sim->slotreq = malloc(MAXPROCESSES*MAXPROCPAGES*sizeof(long)); 
+	    if (!sim->dev || !sim->slotreq) DIE("out of memory for swap device"); 
+	} 
+	if (dirty>=0) { 
+	    sim->dirty = dirty; 
+	    sim->writebehind = writebehind; 
+	    sim->slotdirty = calloc(MAXPROCESSES*MAXPROCPAGES, sizeof(unsigned char)); 
+	    sim->slotndirty = calloc(MAXPROCESSES, sizeof(long)); 
+	    if (!sim->slotdirty || !sim->slotndirty) DIE("out of memory for dirty pages"); 
+	} 
+	if (statsfile) { 
+	    sim->stats = stats_new(jobs, refault); 
+	    sim->slotevicted = malloc(MAXPROCESSES*MAXPROCPAGES*sizeof(long)); 
+	    if (!sim->stats || !sim->slotevicted) DIE("out of memory for statistics"); 
+	} 
+	if (npagers>1) sim_log(LOG_ALWAYS,"pager %s\n", ops[p]->name); 
+	sim_log(LOG_ALWAYS,"random seed %d\n", seed); 
+	sim_log(LOG_ALWAYS,"using %d processors\n", procs); 
+
+	sim_run(); 
+	block[p] = sim->block; 
+	compute[p] = sim->compute; 
+	if (statsfile && stats_write(sim->stats, statsfile, 
+				     sim->ops ? sim->ops->name : argv[0], seed, 
+				     sim->sysclock, PHYSICALPAGES)!=STATS_SUCCESS) { 
+	    fprintf(stderr, "%s: could not write %s\n", argv[0], statspath); 
+	    return EXIT_FAILURE; 
+	} 
+	sim_free(sim); 
+	sim = NULL; 
+    } 
+    if (npagers>1) { 
+	fprintf(stderr, "%-16s %12s %12s %10s\n", 
+		"pager", "blocked", "compute", "ratio"); 
+	for (p=0; p<npagers; p++) 
+	    fprintf(stderr, "%-16s %12ld %12ld %10g\n", ops[p]->name, 
+		    block[p], compute[p], (double)block[p]/(double)compute[p]); 
+    } 
+    if (replay) replay_close(replay); 
+    if (programs!=defaultprograms) workload_free(programs, nprograms); 
+    else for (i=0; i<nprograms; i++) free(programs[i].pcaction); 
+
+    if (statsfile && fclose(statsfile)!=0) { 
+	fprintf(stderr, "%s: could not write %s\n", argv[0], statspath); 
+	return EXIT_FAILURE; 
+    } 
+    if (trace && trace_close(trace)!=TRACE_SUCCESS) { 
+	fprintf(stderr, "%s: could not write event trace\n", argv[0]); 
+	return EXIT_FAILURE; 
+    } 
+    if (output && pages) { 
+	if (tracepath) in = trace_read(tracepath, &gzip); 
+	else rewind(in); 
+	if (!in || trace_csv(in, output, pages)!=TRACE_SUCCESS 
+	 || trace_read_close(in, gzip)!=TRACE_SUCCESS) { 
+	    fprintf(stderr, "%s: could not convert event trace to csv\n", argv[0]); 
+	    return EXIT_FAILURE; 
+	} 
+	fclose(output); 
+	fclose(pages); 
     } 
-    allscore(); 
 
     return EXIT_SUCCESS;
 
@@ -16,27 +16,76 @@
 #define TRUE  1
 #define FALSE 0
 
-#define MAXPROCPAGES 20 	/* max pages per individual process */ 
-#define MAXPROCESSES 20 	/* max number of processes in runqueue */ 
-#define PAGESIZE 128 		/* size of an individual page */ 
-#define PAGEWAIT 100 		/* wait for paging in */ 
-#define PHYSICALPAGES 100	/* number of available physical pages */ 
+/* Simulator scale. These used to be compile-time constants; the
+ * defaults below are still the original sizes, but each can be
+ * changed on the simulator command line, so pagers must size any
+ * tables they keep at run time rather than with static arrays. */ 
+struct simscale {
+    long maxprocpages; 	/* max pages per individual process */ 
+    long maxprocesses; 	/* max number of processes in runqueue */ 
+    long pagesize; 	/* size of an individual page */ 
+    long pagewait; 	/* wait for paging in */ 
+    long physicalpages; /* number of available physical pages */ 
+};
+
+extern struct simscale simscale; 
+
+#define DEFAULT_MAXPROCPAGES 20 
+#define DEFAULT_MAXPROCESSES 20 
+#define DEFAULT_PAGESIZE 128 
+#define DEFAULT_PAGEWAIT 100 
+#define DEFAULT_PHYSICALPAGES 100 
+
+#define MAXPROCPAGES (simscale.maxprocpages) 
+#define MAXPROCESSES (simscale.maxprocesses) 
+#define PAGESIZE (simscale.pagesize) 
+#define PAGEWAIT (simscale.pagewait) 
+#define PHYSICALPAGES (simscale.physicalpages) 
 #define MAXPC (MAXPROCPAGES*PAGESIZE) /* largest PC value */ 
 
+/* Free-form argument for the pager, from -pagerarg; NULL if not given. */ 
+extern const char *pagerarg; 
+
+/* A pager's read-only view of one process slot. pages points into
+ * simulator storage that is kept up to date as pages move, so
+ * handing the table to pageit() costs nothing per page. */ 
 struct pentry {
     long active; 
     long pc; 
     long npages; 
-    long pages[MAXPROCPAGES]; /* 0 if not allocated, 1 if allocated */ 
+    long *pages; /* npages entries: 0 if not allocated, 1 if allocated */ 
 };
 
 typedef struct pentry Pentry; 
 
+/* Events delivered to pageit_events(). Instead of rescanning the
+ * whole process table every tick, an event-driven pager is told
+ * only what changed since its last call. */
+#define PAGER_LOAD          0	/* process loaded into a slot */
+#define PAGER_UNLOAD        1	/* process exited; all its pages are free */
+#define PAGER_FAULT         2	/* process blocked on a page not in memory */
+#define PAGER_PCPAGE        3	/* pc moved from prevpage to page */
+#define PAGER_PAGEIN_DONE   4	/* page finished swapping in */
+#define PAGER_PAGEOUT_DONE  5	/* page finished swapping out; frame free */
+
+struct pevent {
+    int type;      /* one of PAGER_* */
+    int process;   /* process slot (0 to MAXPROCESSES-1) */
+    int page;      /* page faulted, transferred, or now under pc */
+    int prevpage;  /* PAGER_PCPAGE only: page the pc left */
+    long pc;       /* pc of the process when the event happened */
+    long kind;     /* which program the process is running */
+    long pid;      /* which job: a suspended one keeps its pid when it
+                      is loaded again, and -reftrace traces are by pid */
+};
+
+typedef struct pevent Pevent;
+
 /* int pagein (int process, int page)
  *   This pages in the requested page
  * Arguments:
- *   proc: process to work upon (0-19) 
- *   page: page to put in (0-19)
+ *   proc: process to work upon (0 to MAXPROCESSES-1) 
+ *   page: page to put in (0 to MAXPROCPAGES-1)
  * Returns:
  *   1 if pagein started, already running, or paged in
  *   0 if it can't start (e.g., swapping out) 
@@ -46,7 +95,7 @@ extern int pagein (int process, int page);
 /* int pageout(int process, int page)
  *   This pages out the requested page.
  * Arguments:
- *   proc: process to work upon (0-19)
+ *   proc: process to work upon (0 to MAXPROCESSES-1)
  *   page: page to swap out. 
  * Returns: 
  *   1 if pageout started, already running, or paged out
@@ -54,9 +103,46 @@ extern int pagein (int process, int page);
  */
 extern int pageout(int process, int page); 
 
+/* int pagein_range (int process, int page, int npages)
+ *   This pages in npages pages from page on, as pagein() would
+ *   one by one, but asks the swap device (-swapdev) for each run
+ *   of them it starts as one transfer, so only the first can
+ *   cost a seek. Without a device it is just the loop.
+ * Arguments:
+ *   proc: process to work upon (0 to MAXPROCESSES-1) 
+ *   page: first page to put in
+ *   npages: number of pages
+ * Returns:
+ *   number of pages, from page on, for which pagein() would have
+ *   returned 1; it stops at the first that fails
+ */
+extern int pagein_range (int process, int page, int npages); 
+
+/* int pageout_range (int process, int page, int npages)
+ *   As pagein_range(), for pageout(). Only dirty pages are 
+ *   written; clean ones are dropped (see pagedirty()).
+ * Returns:
+ *   number of pages, from page on, for which pageout() would have
+ *   returned 1
+ */
+extern int pageout_range (int process, int page, int npages); 
+
+/* int pagedirty (int process, int page)
+ *   Whether a page has been written since it came in. With 
+ *   -dirty, processes write to some of their pages; paging out a
+ *   clean page frees its frame in one tick without using the swap 
+ *   device, and with -writebehind the simulator writes dirty pages
+ *   back while the device is idle. Without -dirty every page
+ *   counts as dirty.
+ * Returns:
+ *   1 if paging it out needs a write, else 0
+ */
+extern int pagedirty (int process, int page); 
+
 /* void pageit(Pentry q[MAXPROCESSES])
  *   This is called by the simulator
- *   every time something interesting occurs.
+ *   every tick, even while every process is blocked, so
+ *   unlike pageit_events() it never lets idle ticks be skipped.
  *   It is where you implement the paging strategy.
  * Arguments:   
  *   q: state of every process
@@ -64,3 +150,52 @@ extern int pageout(int process, int page);
  *   void 
  */
 extern void pageit(Pentry q[MAXPROCESSES]); 
+
+/* void pageit_events(Pevent events[], int nevents, long clock)
+ *   Optional event-driven alternative to pageit(). If a pager
+ *   defines it, the simulator calls it instead of pageit(), once
+ *   per tick in which something happened, with the events of that
+ *   tick in order. Frames only become free through PAGER_UNLOAD
+ *   and PAGER_PAGEOUT_DONE, so a pagein() that failed can be
+ *   retried when one of those arrives.
+ * Arguments:
+ *   events: what happened since the last call
+ *   nevents: number of events
+ *   clock: current simulator time
+ * Returns:
+ *   void
+ */
+extern void pageit_events(Pevent events[], int nevents, long clock);
+
+/* Pager plugins. Instead of the functions above, a pager can export
+ * one struct pagerops named pager_plugin, either linked into the
+ * simulator or built as a shared object and loaded with -pager. A
+ * plugin keeps all of its state in what init() returns, rather than
+ * in statics, and reaches the simulator only through the pagerhost
+ * it is handed, so one simulator can load several plugins and run
+ * each of them against the same jobs. */
+#define PAGER_ABI 3 	/* bump when either struct below changes */
+
+struct pagerhost {
+    struct simscale scale;   /* scale of this run */
+    const char *arg;         /* -pagerarg, or NULL */
+    int (*pagein)(int process, int page);
+    int (*pageout)(int process, int page);
+    int (*pagein_range)(int process, int page, int npages);
+    int (*pageout_range)(int process, int page, int npages);
+    int (*dirty)(int process, int page);
+};
+
+struct pagerops {
+    int abi;                 /* PAGER_ABI */
+    const char *name;
+    /* start a run; host stays valid until fini() */
+    void *(*init)(const struct pagerhost *host);
+    /* as pageit_events(); if NULL, pageit() is called every tick */
+    void (*events)(void *state, Pevent events[], int nevents, long clock);
+    void (*pageit)(void *state, Pentry q[]);
+    /* end of the run: release state */
+    void (*fini)(void *state);
+};
+
+extern const struct pagerops pager_plugin;
@@ -0,0 +1,216 @@
+/*
+ * File: stats.c
+ *
+ * Project: CSCI 3753 Programming Assignment 4
+ * Description:
+ * 	Paging statistics for -stats; see stats.h. Counting is all
+ *      per job, so slots stepped on different threads never count
+ *      into the same place; the totals are only made when writing.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "stats.h"
+
+/* one row of counters: per kind and for the whole run */
+struct statsum {
+    long jobs;
+    long compute;
+    long block;
+    long faults;
+    long refaults;
+    long pageins;
+    long evictions;
+    long latency[STATS_BUCKETS];
+};
+
+Stats *stats_new(long njobs, long window)
+{
+    Stats *s = calloc(1, sizeof(Stats));
+    long i;
+
+    if (!s) {
+	return NULL;
+    }
+    s->jobs = calloc(njobs, sizeof(struct jobstats));
+    if (!s->jobs) {
+	free(s);
+	return NULL;
+    }
+    for (i = 0; i < njobs; i++) {
+	s->jobs[i].faultat = -1;
+    }
+    s->njobs = njobs;
+    s->window = window;
+    return s;
+}
+
+void stats_fault(Stats *s, struct jobstats *j, long clock, long evictedat)
+{
+    j->faults++;
+    j->faultat = clock;
+    if (evictedat >= 0 && clock - evictedat <= s->window) {
+	j->refaults++;
+    }
+}
+
+void stats_resume(struct jobstats *j, long clock)
+{
+    long ticks = clock - j->faultat;
+    int b = 0;
+
+    if (j->faultat < 0) {
+	return;
+    }
+    while (b < STATS_BUCKETS - 1 && ticks >> (b + 1)) {
+	b++;
+    }
+    j->latency[b]++;
+    j->faultat = -1;
+}
+
+void stats_frames(Stats *s, long clock, long used, long ticks)
+{
+    long n;
+    long i;
+
+    while (ticks > 0) {
+	i = clock / STATS_INTERVAL;
+	n = (i + 1) * STATS_INTERVAL - clock;
+	if (n > ticks) {
+	    n = ticks;
+	}
+	if (i >= s->maxframes) {
+	    s->maxframes = i >= 2 * s->maxframes ? i + 64 : 2 * s->maxframes;
+	    s->frames = realloc(s->frames, s->maxframes * sizeof(double));
+	    if (!s->frames) {
+		perror("Error on stats Malloc");
+		exit(EXIT_FAILURE);
+	    }
+	}
+	while (s->nframes <= i) {
+	    s->frames[s->nframes++] = 0;
+	}
+	s->frames[i] += (double) used * n;
+	clock += n;
+	ticks -= n;
+    }
+}
+
+static void stats_add(struct statsum *sum, const struct jobstats *j)
+{
+    int b;
+
+    sum->jobs++;
+    sum->compute += j->compute;
+    sum->block += j->block;
+    sum->faults += j->faults;
+    sum->refaults += j->refaults;
+    sum->pageins += j->pageins;
+    sum->evictions += j->evictions;
+    for (b = 0; b < STATS_BUCKETS; b++) {
+	sum->latency[b] += j->latency[b];
+    }
+}
+
+/* latency buckets, leaving off the empty ones at the end */
+static void stats_latency(FILE *fp, const long *latency)
+{
+    int n = STATS_BUCKETS;
+    int b;
+
+    while (n > 0 && latency[n - 1] == 0) {
+	n--;
+    }
+    fputc('[', fp);
+    for (b = 0; b < n; b++) {
+	fprintf(fp, "%s%ld", b ? "," : "", latency[b]);
+    }
+    fputc(']', fp);
+}
+
+static void stats_counts(FILE *fp, const struct statsum *sum)
+{
+    fprintf(fp, "\"jobs\":%ld,\"compute\":%ld,\"blocked\":%ld,"
+	    "\"faults\":%ld,\"refaults\":%ld,\"pageins\":%ld,"
+	    "\"evictions\":%ld,\"latency_log2\":",
+	    sum->jobs, sum->compute, sum->block, sum->faults,
+	    sum->refaults, sum->pageins, sum->evictions);
+    stats_latency(fp, sum->latency);
+}
+
+int stats_write(Stats *s, FILE *fp, const char *pager, long seed,
+		long clock, long physical)
+{
+    struct statsum total;
+    struct statsum *kinds;
+    struct statsum one;
+    long nkinds = 0;
+    long i;
+    long n;
+    const char *c;
+
+    for (i = 0; i < s->njobs; i++) {
+	if (s->jobs[i].kind >= nkinds) {
+	    nkinds = s->jobs[i].kind + 1;
+	}
+    }
+    kinds = calloc(nkinds ? nkinds : 1, sizeof(struct statsum));
+    if (!kinds) {
+	return STATS_FAILURE;
+    }
+    memset(&total, 0, sizeof(total));
+    for (i = 0; i < s->njobs; i++) {
+	stats_add(&total, &s->jobs[i]);
+	if (s->jobs[i].kind >= 0) {
+	    stats_add(&kinds[s->jobs[i].kind], &s->jobs[i]);
+	}
+    }
+
+    fputs("{\"pager\":\"", fp);
+    for (c = pager; *c; c++) {
+	if (*c == '"' || *c == '\\') {
+	    fputc('\\', fp);
+	}
+	fputc(*c, fp);
+    }
+    fprintf(fp, "\",\"seed\":%ld,\"ticks\":%ld,\"physical\":%ld,"
+	    "\"refault_window\":%ld,\"total\":{", seed, clock, physical,
+	    s->window);
+    stats_counts(fp, &total);
+    fputs("},\"kinds\":[", fp);
+    for (i = n = 0; i < nkinds; i++) {
+	if (kinds[i].jobs) {
+	    fprintf(fp, "%s{\"kind\":%ld,", n++ ? "," : "", i);
+	    stats_counts(fp, &kinds[i]);
+	    fputc('}', fp);
+	}
+    }
+    fputs("],\"jobs\":[", fp);
+    for (i = 0; i < s->njobs; i++) {
+	memset(&one, 0, sizeof(one));
+	stats_add(&one, &s->jobs[i]);
+	fprintf(fp, "%s{\"pid\":%ld,\"kind\":%ld,", i ? "," : "",
+		s->jobs[i].pid, s->jobs[i].kind);
+	stats_counts(fp, &one);
+	fputc('}', fp);
+    }
+    /* mean frames in use over each interval; the last may be short */
+    fprintf(fp, "],\"frames_interval\":%d,\"frames_used\":[", STATS_INTERVAL);
+    for (i = 0; i < s->nframes; i++) {
+	n = i == s->nframes - 1 && clock > i * STATS_INTERVAL
+	    ? clock - i * STATS_INTERVAL : STATS_INTERVAL;
+	fprintf(fp, "%s%.2f", i ? "," : "", s->frames[i] / n);
+    }
+    fputs("]}\n", fp);
+    free(kinds);
+    return ferror(fp) ? STATS_FAILURE : STATS_SUCCESS;
+}
+
+void stats_free(Stats *s)
+{
+    free(s->jobs);
+    free(s->frames);
+    free(s);
+}
@@ -0,0 +1,73 @@
+/*
+ * File: stats.h
+ *
+ * Project: CSCI 3753 Programming Assignment 4
+ * Description:
+ * 	Paging statistics for -stats. The simulator counts, for every
+ *      job, its faults, the pageins and evictions of its pages, how
+ *      many faults hit a page evicted only a little earlier, and how
+ *      long each fault kept it blocked; it also samples how many
+ *      frames are in use. stats_write() sums these up by program
+ *      kind and for the whole run and writes them as one line of
+ *      JSON, so runs of several pagers can go to one file.
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+
+#define STATS_FAILURE -1
+#define STATS_SUCCESS 0
+
+#define STATS_BUCKETS 32        /* latency bucket i: 2^i to 2^(i+1)-1 ticks */
+#define STATS_INTERVAL 1000     /* ticks per frame usage sample */
+
+struct jobstats {
+    long pid;
+    long kind;
+    long compute;
+    long block;
+    long faults;                /* times the job blocked on a page */
+    long refaults;              /* faults on a page evicted within the window */
+    long pageins;
+    long evictions;             /* pageouts of the job's pages */
+    long faultat;               /* tick of the fault being served */
+    long latency[STATS_BUCKETS]; /* ticks from fault to running again */
+};
+
+typedef struct stats {
+    long window;                /* refault window, in ticks */
+    long njobs;
+    struct jobstats *jobs;      /* one per job, in queue order */
+    double *frames;             /* frame ticks used per interval */
+    long nframes;
+    long maxframes;
+} Stats;
+
+/* Function to make empty statistics for njobs jobs
+ * Returns NULL if out of memory
+ */
+Stats *stats_new(long njobs, long window);
+
+/* Function to count a fault and, if the page was evicted at
+ * evictedat (-1 if never), whether it came back too soon
+ */
+void stats_fault(Stats *s, struct jobstats *j, long clock, long evictedat);
+
+/* Function to note that a blocked job runs again at clock */
+void stats_resume(struct jobstats *j, long clock);
+
+/* Function to add used frames for ticks ticks from clock on */
+void stats_frames(Stats *s, long clock, long used, long ticks);
+
+/* Function to write the run's statistics as one line of JSON
+ * Returns STATS_SUCCESS, or STATS_FAILURE if writing failed
+ */
+int stats_write(Stats *s, FILE *fp, const char *pager, long seed,
+                long clock, long physical);
+
+/* Function to release statistics */
+void stats_free(Stats *s);
+
+#endif
@@ -0,0 +1,227 @@
+/*
+ * File: swapdev.c
+ *
+ * Project: CSCI 3753 Programming Assignment 4
+ * Description:
+ * 	The swap device for -swapdev; see swapdev.h. A policy only
+ *      picks which queued request goes next, so another one is a
+ *      function and a line in the table below.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "swapdev.h"
+
+struct swappolicy {
+    const char *name;
+    long (*pick)(Swapdev *d);   /* index of the request to start */
+};
+
+static long swapdev_fifo(Swapdev *d)
+{
+    (void) d;
+    return 0;
+}
+
+/* the nearest request on in the direction the head is sweeping; if
+ * there is none that way, turn round. Of requests for one block the
+ * oldest goes first */
+static long swapdev_elevator(Swapdev *d)
+{
+    long best;
+    long b;
+    long i;
+    int pass;
+
+    for (pass = 0; pass < 2; pass++) {
+	best = -1;
+	for (i = 0; i < d->nqueue; i++) {
+	    b = d->queue[i].block;
+	    if (d->down ? b >= d->head : b < d->head) {
+		continue;
+	    }
+	    if (best < 0 || (d->down ? b > d->queue[best].block
+			     : b < d->queue[best].block)) {
+		best = i;
+	    }
+	}
+	if (best >= 0) {
+	    return best;
+	}
+	d->down = !d->down;
+    }
+    return 0;
+}
+
+static const struct swappolicy swapdev_policies[] = {
+    { "fifo", swapdev_fifo },
+    { "elevator", swapdev_elevator },
+};
+
+Swapdev *swapdev_new(const char *policy, long channels, long random,
+		     long sequential, long bandwidth, long period)
+{
+    Swapdev *d;
+    size_t i;
+
+    for (i = 0; i < sizeof(swapdev_policies) / sizeof(swapdev_policies[0]); i++) {
+	if (!strcmp(policy, swapdev_policies[i].name)) {
+	    break;
+	}
+    }
+    if (i == sizeof(swapdev_policies) / sizeof(swapdev_policies[0])) {
+	return NULL;
+    }
+    d = calloc(1, sizeof(Swapdev));
+    if (!d) {
+	return NULL;
+    }
+    d->busyuntil = calloc(channels, sizeof(long));
+    if (!d->busyuntil) {
+	free(d);
+	return NULL;
+    }
+    d->policy = &swapdev_policies[i];
+    d->channels = channels;
+    d->random = random;
+    d->sequential = sequential;
+    d->bandwidth = bandwidth;
+    d->period = period;
+    d->head = -1;
+    return d;
+}
+
+/* make room in the queue for one more request */
+static void swapdev_grow(Swapdev *d)
+{
+    if (d->nqueue == d->maxqueue) {
+	d->maxqueue = d->maxqueue ? 2 * d->maxqueue : 64;
+	d->queue = realloc(d->queue, d->maxqueue * sizeof(struct swapreq));
+	if (!d->queue) {
+	    perror("Error on swap device Malloc");
+	    exit(EXIT_FAILURE);
+	}
+    }
+}
+
+long swapdev_submit(Swapdev *d, long block, long count, long clock)
+{
+    swapdev_grow(d);
+    d->queue[d->nqueue].block = block;
+    d->queue[d->nqueue].count = count;
+    d->queue[d->nqueue].id = d->nextid;
+    d->queue[d->nqueue].at = clock;
+    d->nqueue++;
+    if (d->nqueue > d->longest) {
+	d->longest = d->nqueue;
+    }
+    return d->nextid++;
+}
+
+void swapdev_start(Swapdev *d, long clock, int (*wanted)(long block, long id),
+		   void (*started)(long block, long due))
+{
+    struct swapreq r;
+    long c;
+    long i;
+    long n;
+    long due;
+    long k;
+    long end;
+
+    /* drop the blocks wanted() turns down; a request left with holes
+       goes on as one request per run of blocks still wanted */
+    for (i = n = 0; i < d->nqueue; i++) {
+	r = d->queue[i];
+	for (k = 0; k < r.count; k = end) {
+	    while (k < r.count && !wanted(r.block + k, r.id)) {
+		k++;
+	    }
+	    for (end = k; end < r.count && wanted(r.block + end, r.id); end++)
+		;
+	    if (k == r.count) {
+		break;
+	    }
+	    if (n > i) { /* a second run: it goes before the next request */
+		swapdev_grow(d);
+		memmove(d->queue + i + 2, d->queue + i + 1,
+			(d->nqueue - i - 1) * sizeof(struct swapreq));
+		d->nqueue++;
+		i++;
+	    }
+	    d->queue[n] = r;
+	    d->queue[n].block = r.block + k;
+	    d->queue[n].count = end - k;
+	    n++;
+	}
+    }
+    d->nqueue = n;
+
+    while (d->nqueue > 0) {
+	for (c = 0; c < d->channels && d->busyuntil[c] > clock; c++)
+	    ;
+	if (c == d->channels
+	    || (d->bandwidth && d->bus > clock * d->bandwidth)) {
+	    break;
+	}
+	i = d->policy->pick(d);
+	r = d->queue[i];
+	memmove(d->queue + i, d->queue + i + 1,
+		(d->nqueue - i - 1) * sizeof(struct swapreq));
+	d->nqueue--;
+
+	/* one seek, if any, then the blocks one after another */
+	due = clock + (r.count - 1) * d->sequential;
+	if (r.block == d->head) {
+	    due += d->sequential;
+	    d->sequentials++;
+	} else {
+	    due += d->random;
+	}
+	d->head = r.block + r.count;
+	d->busyuntil[c] = due;
+	if (d->bandwidth) {
+	    if (d->bus < clock * d->bandwidth) {
+		d->bus = clock * d->bandwidth;
+	    }
+	    d->bus += r.count * d->period;
+	}
+	d->transfers++;
+	d->pages += r.count;
+	d->waited += clock - r.at;
+	for (k = 0; k < r.count; k++) {
+	    started(r.block + k, due);
+	}
+    }
+}
+
+long swapdev_ready(Swapdev *d)
+{
+    long next;
+    long c;
+
+    next = d->busyuntil[0];
+    for (c = 1; c < d->channels; c++) {
+	if (d->busyuntil[c] < next) {
+	    next = d->busyuntil[c];
+	}
+    }
+    if (d->bandwidth && (d->bus + d->bandwidth - 1) / d->bandwidth > next) {
+	next = (d->bus + d->bandwidth - 1) / d->bandwidth;
+    }
+    return next;
+}
+
+long swapdev_next(Swapdev *d)
+{
+    return d->nqueue ? swapdev_ready(d) : -1;
+}
+
+void swapdev_free(Swapdev *d)
+{
+    free(d->busyuntil);
+    free(d->queue);
+    free(d);
+}
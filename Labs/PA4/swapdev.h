@@ -0,0 +1,82 @@
+/*
+ * File: swapdev.h
+ *
+ * Project: CSCI 3753 Programming Assignment 4
+ * Description:
+ * 	A swap device for -swapdev. Without it every pagein and pageout
+ *      takes PAGEWAIT ticks however many are under way. With it,
+ *      transfers queue for a few channels, are taken from the queue
+ *      in the order of a policy (first come first served, or an
+ *      elevator that sweeps over the device), cost less when they
+ *      follow on from the page last transferred than when the device
+ *      has to seek, and can be held to a number of pages per period.
+ *      Pages are device blocks: the simulator numbers them so the
+ *      pages of one process slot are contiguous, and a request can
+ *      be for a run of them, which costs one seek at most.
+ */
+
+#ifndef SWAPDEV_H
+#define SWAPDEV_H
+
+struct swapreq {
+    long block;                 /* first of count blocks */
+    long count;
+    long id;                    /* as swapdev_submit() returned it */
+    long at;                    /* tick it was submitted in */
+};
+
+typedef struct swapdev {
+    const struct swappolicy *policy;
+    long channels;              /* transfers the device runs at once */
+    long *busyuntil;            /* per channel: tick its transfer ends */
+    long random;                /* ticks for a transfer after a seek */
+    long sequential;            /* ticks for the block after the last */
+    long bandwidth;             /* pages per period; 0 for no cap */
+    long period;
+    long bus;                   /* earliest start, in 1/bandwidth ticks */
+    long head;                  /* block after the last one started */
+    int down;                   /* elevator sweeping to lower blocks */
+    struct swapreq *queue;      /* waiting, oldest first */
+    long nqueue;
+    long maxqueue;
+    long nextid;
+    long transfers;             /* totals, for the end of the run */
+    long pages;
+    long sequentials;
+    long waited;                /* ticks spent queued */
+    long longest;               /* longest queue */
+} Swapdev;
+
+/* Function to make an idle device; policy is "fifo" or "elevator"
+ * Returns NULL for any other policy, or if out of memory
+ */
+Swapdev *swapdev_new(const char *policy, long channels, long random,
+                     long sequential, long bandwidth, long period);
+
+/* Function to queue a transfer of count blocks from block on at clock
+ * Returns the request's id
+ */
+long swapdev_submit(Swapdev *d, long block, long count, long clock);
+
+/* Function to start queued transfers for as long as channels and
+ * bandwidth allow. Blocks wanted() turns down are dropped unstarted,
+ * splitting their request round them if it has others still wanted;
+ * started() is told when each block that is started will finish
+ */
+void swapdev_start(Swapdev *d, long clock, int (*wanted)(long block, long id),
+                   void (*started)(long block, long due));
+
+/* Function to find the first tick a new transfer could start in
+ * Returns that tick, which may be in the past
+ */
+long swapdev_ready(Swapdev *d);
+
+/* Function to find the first tick a queued transfer could start in
+ * Returns that tick, or -1 if none is queued
+ */
+long swapdev_next(Swapdev *d);
+
+/* Function to release a device */
+void swapdev_free(Swapdev *d);
+
+#endif
@@ -0,0 +1,254 @@
+/*
+ * File: trace.c
+ *
+ * Project: CSCI 3753 Programming Assignment 4
+ * Description:
+ * 	Binary event trace writer and reader. A trace is a header
+ *      followed by struct tracerec records in host byte order.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "trace.h"
+
+#define TRACE_MAGIC "PA4TRACE"
+#define TRACE_VERSION 2
+#define TRACE_BUFRECS 4096
+
+struct traceheader {
+    char magic[8];
+    uint32_t version;
+    uint32_t recsize;
+};
+
+static const char *trace_names[TRACE_EVENTS] = {
+    "load", "unload", "blocked", "unblocked", "exit",
+    "branch_from", "branch_to", "out_of_range", "restart",
+    "going", "coming", "in", "out",
+};
+
+static int trace_gzipped(const char *path)
+{
+    size_t len = strlen(path);
+    return len > 3 && !strcmp(path + len - 3, ".gz");
+}
+
+/* run gzip with one end on fd and the other on a new pipe */
+static FILE *trace_gzip(int fd, int compress, pid_t *pid)
+{
+    int fds[2];
+    FILE *fp;
+
+    if (pipe(fds) < 0) {
+	return NULL;
+    }
+    *pid = fork();
+    if (*pid < 0) {
+	close(fds[0]);
+	close(fds[1]);
+	return NULL;
+    }
+    if (*pid == 0) {
+	if (compress) {
+	    dup2(fds[0], STDIN_FILENO);
+	    dup2(fd, STDOUT_FILENO);
+	} else {
+	    dup2(fd, STDIN_FILENO);
+	    dup2(fds[1], STDOUT_FILENO);
+	}
+	close(fds[0]);
+	close(fds[1]);
+	close(fd);
+	execlp("gzip", "gzip", compress ? "-c1" : "-dc", (char *) NULL);
+	_exit(127);
+    }
+    close(fd);
+    if (compress) {
+	close(fds[0]);
+	fp = fdopen(fds[1], "w");
+    } else {
+	close(fds[1]);
+	fp = fdopen(fds[0], "r");
+    }
+    return fp;
+}
+
+static int trace_wait(pid_t pid)
+{
+    int status;
+
+    while (waitpid(pid, &status, 0) < 0) {
+	if (errno != EINTR) {
+	    return TRACE_FAILURE;
+	}
+    }
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0
+	? TRACE_SUCCESS : TRACE_FAILURE;
+}
+
+Tracefile *trace_wrap(FILE *fp)
+{
+    Tracefile *t = calloc(1, sizeof(Tracefile));
+    struct traceheader h;
+
+    if (!t) {
+	return NULL;
+    }
+    t->fp = fp;
+    t->buf = malloc(TRACE_BUFRECS * sizeof(struct tracerec));
+    if (!t->buf) {
+	free(t);
+	return NULL;
+    }
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, TRACE_MAGIC, sizeof(h.magic));
+    h.version = TRACE_VERSION;
+    h.recsize = sizeof(struct tracerec);
+    fwrite(&h, sizeof(h), 1, fp);
+    return t;
+}
+
+Tracefile *trace_create(const char *path)
+{
+    Tracefile *t;
+    FILE *fp;
+    pid_t gzip = 0;
+    int fd;
+
+    if (trace_gzipped(path)) {
+	fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+	    return NULL;
+	}
+	fp = trace_gzip(fd, 1, &gzip);
+    } else {
+	fp = fopen(path, "w");
+    }
+    if (!fp) {
+	return NULL;
+    }
+    t = trace_wrap(fp);
+    if (!t) {
+	fclose(fp);
+	return NULL;
+    }
+    t->gzip = gzip;
+    t->owned = 1;
+    return t;
+}
+
+int trace_put(Tracefile *t, long clock, long slot, long pid, long kind,
+	      long value, int event)
+{
+    struct tracerec *r;
+    int ret = TRACE_SUCCESS;
+
+    if (t->nbuf == TRACE_BUFRECS) {
+	ret = trace_flush(t);
+    }
+    r = t->buf + t->nbuf++;
+    r->clock = clock;
+    r->value = value;
+    r->pid = pid;
+    r->slot = slot;
+    r->kind = kind;
+    r->event = event;
+    r->reserved = 0;
+    return ret;
+}
+
+int trace_flush(Tracefile *t)
+{
+    size_t n = t->nbuf;
+
+    t->nbuf = 0;
+    if (fwrite(t->buf, sizeof(struct tracerec), n, t->fp) != n) {
+	t->failed = 1;
+    }
+    return t->failed ? TRACE_FAILURE : TRACE_SUCCESS;
+}
+
+int trace_close(Tracefile *t)
+{
+    int ret = trace_flush(t);
+
+    if (fflush(t->fp) != 0) {
+	ret = TRACE_FAILURE;
+    }
+    if (t->owned && fclose(t->fp) != 0) {
+	ret = TRACE_FAILURE;
+    }
+    if (t->gzip && trace_wait(t->gzip) != TRACE_SUCCESS) {
+	ret = TRACE_FAILURE;
+    }
+    free(t->buf);
+    free(t);
+    return ret;
+}
+
+FILE *trace_read(const char *path, pid_t *gzip)
+{
+    int fd;
+
+    *gzip = 0;
+    if (!trace_gzipped(path)) {
+	return fopen(path, "r");
+    }
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+	return NULL;
+    }
+    return trace_gzip(fd, 0, gzip);
+}
+
+int trace_read_close(FILE *fp, pid_t gzip)
+{
+    int ret = fclose(fp) == 0 ? TRACE_SUCCESS : TRACE_FAILURE;
+
+    if (gzip && trace_wait(gzip) != TRACE_SUCCESS) {
+	ret = TRACE_FAILURE;
+    }
+    return ret;
+}
+
+int trace_csv(FILE *in, FILE *output, FILE *pages)
+{
+    struct traceheader h;
+    struct tracerec buf[TRACE_BUFRECS];
+    struct tracerec *r;
+    size_t n, i;
+
+    if (fread(&h, sizeof(h), 1, in) != 1
+	|| memcmp(h.magic, TRACE_MAGIC, sizeof(h.magic))
+	|| h.version != TRACE_VERSION
+	|| h.recsize != sizeof(struct tracerec)) {
+	return TRACE_FAILURE;
+    }
+    while ((n = fread(buf, sizeof(struct tracerec), TRACE_BUFRECS, in)) > 0) {
+	for (i = 0; i < n; i++) {
+	    r = buf + i;
+	    if (r->event >= TRACE_EVENTS) {
+		return TRACE_FAILURE;
+	    }
+	    if (TRACE_ISPAGE(r->event)) {
+		if (pages) {
+		    fprintf(pages, "%ld,%ld,%ld,%ld,%ld,%s\n",
+			    (long) r->clock, (long) r->slot, (long) r->value,
+			    (long) r->pid, (long) r->kind,
+			    trace_names[r->event]);
+		}
+	    } else if (output) {
+		fprintf(output, "%ld,%ld,%ld,%ld,%ld,%s\n",
+			(long) r->clock, (long) r->slot, (long) r->pid,
+			(long) r->kind, (long) r->value,
+			trace_names[r->event]);
+	    }
+	}
+    }
+    return ferror(in) ? TRACE_FAILURE : TRACE_SUCCESS;
+}
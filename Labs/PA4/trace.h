@@ -0,0 +1,99 @@
+/*
+ * File: trace.h
+ *
+ * Project: CSCI 3753 Programming Assignment 4
+ * Description:
+ * 	Binary event traces. The simulator appends one fixed-size
+ *      record per event to a buffer and writes it out in large
+ *      blocks, so tracing a long run costs little more than not
+ *      tracing it; trace2csv turns a trace into the output.csv and
+ *      pages.csv files that -csv used to print event by event.
+ *      A trace whose name ends in .gz is compressed through gzip.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#define TRACE_FAILURE -1
+#define TRACE_SUCCESS 0
+
+/* Events that went to output.csv */
+#define TRACE_LOAD          0
+#define TRACE_UNLOAD        1
+#define TRACE_BLOCKED       2
+#define TRACE_UNBLOCKED     3
+#define TRACE_EXIT          4
+#define TRACE_BRANCH_FROM   5
+#define TRACE_BRANCH_TO     6
+#define TRACE_OUT_OF_RANGE  7
+#define TRACE_RESTART       8
+/* Events that went to pages.csv */
+#define TRACE_GOING         9
+#define TRACE_COMING        10
+#define TRACE_IN            11
+#define TRACE_OUT           12
+#define TRACE_EVENTS        13
+
+#define TRACE_ISPAGE(event) ((event) >= TRACE_GOING)
+
+/* One event. value is the pc for process events and the page for
+ * page events. */
+struct tracerec {
+    int64_t clock;
+    int32_t value;
+    int32_t pid;
+    uint32_t slot;      /* -maxprocs is a long; wide enough for any run */
+    uint8_t kind;
+    uint8_t event;
+    uint16_t reserved;
+};
+
+typedef struct tracefile {
+    FILE *fp;
+    int owned;          /* closed with the trace */
+    pid_t gzip;         /* compressor, 0 if none */
+    struct tracerec *buf;
+    long nbuf;
+    int failed;         /* a write went wrong; trace_close() says so */
+} Tracefile;
+
+/* Function to start writing a trace to path
+ * Returns NULL on failure
+ */
+Tracefile *trace_create(const char *path);
+
+/* Function to write a trace to an already open file, e.g. tmpfile() */
+Tracefile *trace_wrap(FILE *fp);
+
+/* Function to append one event
+ * Returns TRACE_SUCCESS, or TRACE_FAILURE if writing out the full
+ * buffer before it failed
+ */
+int trace_put(Tracefile *t, long clock, long slot, long pid, long kind,
+	      long value, int event);
+
+/* Function to flush buffered events */
+int trace_flush(Tracefile *t);
+
+/* Function to flush and close a trace; the FILE of a wrapped trace is
+ * left open. Returns TRACE_SUCCESS or TRACE_FAILURE */
+int trace_close(Tracefile *t);
+
+/* Function to write a trace read from in as output.csv and pages.csv
+ * lines; either output may be NULL. Returns TRACE_SUCCESS or
+ * TRACE_FAILURE */
+int trace_csv(FILE *in, FILE *output, FILE *pages);
+
+/* Function to open a trace for reading, decompressing .gz names
+ * Returns NULL on failure
+ */
+FILE *trace_read(const char *path, pid_t *gzip);
+
+/* Function to close a trace opened by trace_read */
+int trace_read_close(FILE *fp, pid_t gzip);
+
+#endif
@@ -0,0 +1,51 @@
+/*
+ * File: trace2csv.c
+ *
+ * Project: CSCI 3753 Programming Assignment 4
+ * Description:
+ * 	Converts a binary event trace written by the simulator's
+ *      -trace option into the output.csv and pages.csv files that
+ *      -csv produces.
+ *
+ * Usage:
+ *      trace2csv trace [output.csv [pages.csv]]
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "trace.h"
+
+int main(int argc, char **argv) {
+    const char *outpath = argc > 2 ? argv[2] : "output.csv";
+    const char *pagespath = argc > 3 ? argv[3] : "pages.csv";
+    FILE *in, *output, *pages;
+    pid_t gzip;
+
+    if (argc < 2 || argc > 4) {
+	fprintf(stderr, "usage: %s trace [output.csv [pages.csv]]\n", argv[0]);
+	return EXIT_FAILURE;
+    }
+    in = trace_read(argv[1], &gzip);
+    if (!in) {
+	perror("Error opening trace");
+	return EXIT_FAILURE;
+    }
+    output = fopen(outpath, "w");
+    pages = fopen(pagespath, "w");
+    if (!output || !pages) {
+	perror("Error opening csv output");
+	return EXIT_FAILURE;
+    }
+    if (trace_csv(in, output, pages) != TRACE_SUCCESS
+	|| trace_read_close(in, gzip) != TRACE_SUCCESS) {
+	fprintf(stderr, "%s: %s is not a complete event trace\n",
+		argv[0], argv[1]);
+	return EXIT_FAILURE;
+    }
+    if (fclose(output) != 0 || fclose(pages) != 0) {
+	perror("Error writing csv output");
+	return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,252 @@
+/*
+ * File: workload.c
+ *
+ * Project: CSCI 3753 Programming Assignment 4
+ * Description:
+ * 	Reads workload files for -workload; see workload.h for the
+ *      format.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "workload.h"
+
+struct wlfile {
+    const char *path;
+    long line;
+};
+
+static void workload_error(struct wlfile *f, const char *why)
+{
+    fprintf(stderr, "%s:%ld: %s\n", f->path, f->line, why);
+}
+
+static void *workload_grow(void *p, long n, size_t size)
+{
+    /* grow by doubling: n is the count before adding one */
+    if (n == 0 || (n & (n - 1)) == 0) {
+	p = realloc(p, (n ? 2 * n : 4) * size);
+	if (!p) {
+	    perror("Error on workload Malloc");
+	    exit(EXIT_FAILURE);
+	}
+    }
+    return p;
+}
+
+/* true if nothing but blanks or a comment follows */
+static int workload_end(const char *rest)
+{
+    rest += strspn(rest, " \t\r\n");
+    return *rest == '\0' || *rest == '#';
+}
+
+static int workload_bybranch(const void *a, const void *b)
+{
+    long fa = ((const Branch *) a)->wherefrom;
+    long fb = ((const Branch *) b)->wherefrom;
+
+    return (fa > fb) - (fa < fb);
+}
+
+static int workload_bypc(const void *a, const void *b)
+{
+    long pa = *(const long *) a;
+    long pb = *(const long *) b;
+
+    return (pa > pb) - (pa < pb);
+}
+
+/* check a finished program; sorting it also shows up duplicate branches */
+static int workload_check(struct wlfile *f, Program *p)
+{
+    long i;
+
+    if (p->nexits == 0) {
+	workload_error(f, "program has no exit");
+	return -1;
+    }
+    qsort(p->branches, p->nbranches, sizeof(Branch), workload_bybranch);
+    qsort(p->exits, p->nexits, sizeof(long), workload_bypc);
+    for (i = 1; i < p->nbranches; i++) {
+	if (p->branches[i].wherefrom == p->branches[i - 1].wherefrom) {
+	    workload_error(f, "program has two branches from one pc");
+	    return -1;
+	}
+    }
+    return 0;
+}
+
+static int workload_line(struct wlfile *f, char *line, Program **programs,
+			 long *nprograms)
+{
+    char word[16];
+    char weight[16];
+    Branch b;
+    Program *p;
+    long size;
+    long w = 1;
+    long pc;
+    int n = 0;
+    int fields;
+
+    if (sscanf(line, "%15s%n", word, &n) != 1 || word[0] == '#') {
+	return 0;
+    }
+    line += n;
+    p = *nprograms ? &(*programs)[*nprograms - 1] : NULL;
+
+    if (!strcmp(word, "program")) {
+	fields = sscanf(line, "%ld%n %15s %ld%n", &size, &n, weight, &w, &n);
+	if ((fields != 1 && (fields != 3 || strcmp(weight, "weight")))
+	    || !workload_end(line + n)) {
+	    workload_error(f, "expected program size [weight w]");
+	    return -1;
+	}
+	if (size < 1 || w < 0) {
+	    workload_error(f, "program size must be positive, weight not negative");
+	    return -1;
+	}
+	if (p && workload_check(f, p) < 0) {
+	    return -1;
+	}
+	*programs = workload_grow(*programs, *nprograms, sizeof(Program));
+	p = &(*programs)[(*nprograms)++];
+	memset(p, 0, sizeof(Program));
+	p->size = size;
+	p->weight = w;
+	return 0;
+    }
+    if (!p) {
+	workload_error(f, "expected program before branches and exits");
+	return -1;
+    }
+
+    if (!strcmp(word, "exit")) {
+	if (sscanf(line, "%ld%n", &pc, &n) != 1 || !workload_end(line + n)) {
+	    workload_error(f, "expected exit pc");
+	    return -1;
+	}
+	if (pc < 0 || pc >= p->size) {
+	    workload_error(f, "exit outside the program");
+	    return -1;
+	}
+	p->exits = workload_grow(p->exits, p->nexits, sizeof(long));
+	p->exits[p->nexits++] = pc;
+	return 0;
+    }
+
+    memset(&b, 0, sizeof(b));
+    if (!strcmp(word, "goto")) {
+	b.btype = GOTO;
+	b.prob = 1;
+	fields = sscanf(line, "%ld %ld%n", &b.wherefrom, &b.whereto, &n);
+	fields = fields == 2 ? 0 : -1;
+    } else if (!strcmp(word, "if")) {
+	b.btype = IF;
+	fields = sscanf(line, "%ld %ld %lf%n", &b.wherefrom, &b.whereto,
+			&b.prob, &n);
+	fields = fields == 3 && b.prob >= 0 && b.prob <= 1 ? 0 : -1;
+    } else if (!strcmp(word, "for") || !strcmp(word, "nfor")) {
+	b.btype = word[0] == 'n' ? NFOR : FOR;
+	fields = sscanf(line, "%ld %ld %ld %ld%n", &b.wherefrom, &b.whereto,
+			&b.min, &b.max, &n);
+	fields = fields == 4 && b.min >= 1 && b.max >= b.min ? 0 : -1;
+    } else {
+	workload_error(f, "expected program, goto, if, for, nfor or exit");
+	return -1;
+    }
+    if (fields < 0 || !workload_end(line + n)) {
+	workload_error(f, "bad branch: goto from to, if from to p,"
+		       " for from to min max");
+	return -1;
+    }
+    if (b.wherefrom < 0 || b.wherefrom >= p->size
+	|| b.whereto < 0 || b.whereto >= p->size) {
+	workload_error(f, "branch outside the program");
+	return -1;
+    }
+    p->branches = workload_grow(p->branches, p->nbranches, sizeof(Branch));
+    p->branches[p->nbranches++] = b;
+    return 0;
+}
+
+long workload_load(const char *path, Program **programs)
+{
+    FILE *fp;
+    char line[256];
+    struct wlfile f;
+    long nprograms = 0;
+    long total = 0;
+    long i;
+
+    *programs = NULL;
+    f.path = path;
+    f.line = 0;
+    fp = fopen(path, "r");
+    if (!fp) {
+	perror(path);
+	return -1;
+    }
+    while (fgets(line, sizeof(line), fp)) {
+	f.line++;
+	if (workload_line(&f, line, programs, &nprograms) < 0) {
+	    fclose(fp);
+	    workload_free(*programs, nprograms);
+	    return -1;
+	}
+    }
+    fclose(fp);
+    if (nprograms && workload_check(&f, &(*programs)[nprograms - 1]) < 0) {
+	workload_free(*programs, nprograms);
+	return -1;
+    }
+    for (i = 0; i < nprograms; i++) {
+	total += (*programs)[i].weight;
+    }
+    if (total == 0) {
+	fprintf(stderr, "%s: no program with a positive weight\n", path);
+	workload_free(*programs, nprograms);
+	return -1;
+    }
+    return nprograms;
+}
+
+void workload_compile(Program *programs, long nprograms)
+{
+    Program *p;
+    long i, j;
+
+    for (i = 0; i < nprograms; i++) {
+	p = &programs[i];
+	p->pcaction = malloc((p->size + 1) * sizeof(long));
+	if (!p->pcaction) {
+	    perror("Error on workload Malloc");
+	    exit(EXIT_FAILURE);
+	}
+	for (j = 0; j <= p->size; j++) {
+	    p->pcaction[j] = PC_NEXT;
+	}
+	for (j = 0; j < p->nbranches; j++) {
+	    p->pcaction[p->branches[j].wherefrom] = j;
+	}
+	// an exit wins over a branch from the same pc
+	for (j = 0; j < p->nexits; j++) {
+	    p->pcaction[p->exits[j]] = PC_EXIT;
+	}
+    }
+}
+
+void workload_free(Program *programs, long nprograms)
+{
+    long i;
+
+    for (i = 0; i < nprograms; i++) {
+	free(programs[i].pcaction);
+	free(programs[i].branches);
+	free(programs[i].exits);
+    }
+    free(programs);
+}
@@ -0,0 +1,61 @@
+/*
+ * File: workload.h
+ *
+ * Project: CSCI 3753 Programming Assignment 4
+ * Description:
+ * 	The programs the simulator runs. The built-in ones are in
+ *      programs.c; -workload reads others from a file like
+ *      default.workload, one line per program, branch or exit:
+ *          program 1535 weight 1    size in pcs, share of the jobs
+ *          if 500 1402 0.6          branch from 500 to 1402 with p 0.6
+ *          goto 1401 1533           always branch
+ *          for 1533 0 10 30         loop back 10 to 30 times, then exit
+ *          nfor 1533 0 10 30        as for, but fall through first
+ *          exit 1534                job ends when its pc gets here
+ *      Programs may have any number of branches and exits.
+ */
+
+#ifndef WORKLOAD_H
+#define WORKLOAD_H
+
+typedef enum { GOTO, FOR, NFOR, IF } BranchType;
+
+/* abstract description of a branch
+   describes qualitative behavior, not actual branching */
+typedef struct branch {
+   long wherefrom;
+   long whereto;
+   BranchType btype;
+   long min, max;
+   double prob;
+   long extent;
+} Branch;
+
+typedef struct program {
+   long size;
+   long nbranches;
+   Branch *branches; 	/* sorted by wherefrom */
+   long nexits;
+   long *exits; 	/* which statements are "halt", sorted */
+   long weight; 	/* relative share of the job queue */
+   long *pcaction; 	/* size+1 pcs: PC_NEXT, PC_EXIT or a branch index */
+} Program;
+
+#define PC_NEXT -1 	/* nothing here: go on to the next pc */
+#define PC_EXIT -2 	/* the job ends here */
+
+/* Function to read programs from a workload file
+ * Prints what is wrong and returns -1 on failure, otherwise the
+ * number of programs, which are put in *programs
+ */
+long workload_load(const char *path, Program **programs);
+
+/* Function to build each program's pcaction table, so a process
+ * finds what to do at its pc without searching exits and branches
+ */
+void workload_compile(Program *programs, long nprograms);
+
+/* Function to release programs read by workload_load */
+void workload_free(Program *programs, long nprograms);
+
+#endif